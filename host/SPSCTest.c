@@ -0,0 +1,162 @@
+// SPSCTest.c
+// Runs on a Linux host, not on the LM3S1968
+// Stress and throughput test of AddSPSCFifo and AddSPSCPointerFifo
+// (FIFO.h): a producer thread and a consumer thread, pinned to
+// different cores when there are two, pass a running sequence number
+// through each FIFO and the consumer checks that every number arrives
+// once and in order.  Prints, per FIFO, the items moved, the errors
+// found and the throughput in millions of items per second.
+// Build and run from this directory, with C11 atomics:
+//   gcc -std=c11 -O2 -pthread -I../include SPSCTest.c -o spsctest
+//   ./spsctest [items]          default 100000000, exit status 1 on any error
+// and again with the volatile plus barrier fallback:
+//   gcc -std=gnu89 -O2 -pthread -I../include SPSCTest.c -o spsctest89
+// Billions of items: ./spsctest 4000000000
+// A side that finds its FIFO full or empty yields, so on a one-core
+// machine the threads take turns; that checks the logic but not the
+// memory ordering, which needs two cores.
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "FIFO.h"
+
+#define TESTSIZE  1024        // elements per FIFO
+#define BLOCK     32          // elements per PutBlock/GetBlock
+
+AddSPSCFifo(Idx, TESTSIZE, unsigned long, 1, 0)
+AddSPSCPointerFifo(Ptr, TESTSIZE, unsigned long, 1, 0)
+
+typedef struct{
+  const char *Name;
+  void (*Init)(void);
+  void *(*Producer)(void *);
+  void *(*Consumer)(void *);
+} Test;
+
+unsigned long static Items;   // to move in each test
+unsigned long static Errors;  // out of order numbers seen by the consumer
+
+// run this thread on one core, when the machine has it
+void static pin(int core)
+{
+  cpu_set_t set;
+  if(sysconf(_SC_NPROCESSORS_ONLN) > core){
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+}
+
+void *idxProducer(void *arg){
+  unsigned long i;
+  pin(0);
+  for(i=0; i<Items; i++){
+    while(IdxFifo_Put(i) == 0){
+      sched_yield();
+    }
+  }
+  return arg;
+}
+
+void *idxConsumer(void *arg){
+  unsigned long i, data;
+  pin(1);
+  for(i=0; i<Items; i++){
+    while(IdxFifo_Get(&data) == 0){
+      sched_yield();
+    }
+    if(data != i) Errors++;
+  }
+  return arg;
+}
+
+void *blockProducer(void *arg){
+  unsigned long buf[BLOCK];
+  unsigned long i, n, k, m;
+  pin(0);
+  for(i=0; i<Items; i=i+n){
+    n = (Items-i < BLOCK) ? Items-i : BLOCK;
+    for(k=0; k<n; k++){
+      buf[k] = i+k;
+    }
+    k = 0;
+    while(k < n){
+      m = IdxFifo_PutBlock(&buf[k], (unsigned short)(n-k));
+      if(m == 0) sched_yield();
+      k = k+m;
+    }
+  }
+  return arg;
+}
+
+void *blockConsumer(void *arg){
+  unsigned long buf[BLOCK];
+  unsigned long i, n, k;
+  pin(1);
+  for(i=0; i<Items; i=i+n){
+    n = IdxFifo_GetBlock(buf, BLOCK);
+    if(n == 0) sched_yield();
+    for(k=0; k<n; k++){
+      if(buf[k] != i+k) Errors++;
+    }
+  }
+  return arg;
+}
+
+void *ptrProducer(void *arg){
+  unsigned long i;
+  pin(0);
+  for(i=0; i<Items; i++){
+    while(PtrFifo_Put(i) == 0){
+      sched_yield();
+    }
+  }
+  return arg;
+}
+
+void *ptrConsumer(void *arg){
+  unsigned long i, data;
+  pin(1);
+  for(i=0; i<Items; i++){
+    while(PtrFifo_Get(&data) == 0){
+      sched_yield();
+    }
+    if(data != i) Errors++;
+  }
+  return arg;
+}
+
+Test static Tests[] = {
+  {"index", IdxFifo_Init, idxProducer, idxConsumer},
+  {"indexblock", IdxFifo_Init, blockProducer, blockConsumer},
+  {"pointer", PtrFifo_Init, ptrProducer, ptrConsumer}
+};
+
+int main(int argc, char **argv){
+  pthread_t producer, consumer;
+  struct timespec start, end;
+  double seconds;
+  unsigned long failed = 0;
+  unsigned int t;
+  Items = (argc > 1) ? strtoul(argv[1], 0, 10) : 100000000UL;
+  printf("fifo,items,errors,Mitems/s\n");
+  for(t=0; t<sizeof(Tests)/sizeof(Tests[0]); t++){
+    Tests[t].Init();
+    Errors = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_create(&consumer, 0, Tests[t].Consumer, 0);
+    pthread_create(&producer, 0, Tests[t].Producer, 0);
+    pthread_join(producer, 0);
+    pthread_join(consumer, 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    seconds = (end.tv_sec-start.tv_sec)+(end.tv_nsec-start.tv_nsec)/1e9;
+    printf("%s,%lu,%lu,%.1f\n", Tests[t].Name, Items, Errors, Items/seconds/1e6);
+    failed = failed+Errors;
+  }
+  return failed != 0;
+}
@@ -0,0 +1,43 @@
+// Event.h
+// Runs on LM3S1968
+// Wait/notify between interrupt handlers and foreground code.  A
+// handler posts an event when it has made data or space available;
+// foreground code that finds a FIFO empty (or full) sleeps in WFI until
+// the next post instead of spinning on the FIFO.
+// Usage, with the snapshot taken before the FIFO is checked so a post
+// that lands between the check and the sleep is never missed:
+//   seen = Event_Seen(&RxData);
+//   while(RxFifo_Get(&letter) == FIFOFAIL){
+//     Event_Wait(&RxData, seen, EVENT_FOREVER);
+//     seen = Event_Seen(&RxData);
+//   }
+
+#ifndef __EVENT_H__
+#define __EVENT_H__
+
+#define EVENT_POSTED  1           // Event_Wait return, the event was posted
+#define EVENT_TIMEOUT 0           // Event_Wait return, the time ran out
+#define EVENT_FOREVER 0xFFFFFFFF  // Event_Wait timeout that never expires
+
+typedef struct{
+  unsigned long volatile Posts;   // incremented by every post
+} Event;
+
+// number of posts so far, snapshot it before checking the condition
+#define Event_Seen(EV) ((EV)->Posts)
+
+// called from an interrupt handler (or with interrupts disabled)
+// Input: event to post
+// Output: none
+void Event_Post(Event *ev);
+
+// sleep until ev is posted after the snapshot seen was taken, or until
+//   ms milliseconds have passed (EVENT_FOREVER waits for ever)
+// Must be called with interrupts enabled, the handler that posts has
+//   to be able to run.  Timeouts use SysTick_Ms, so SysTick_Init must
+//   have been called for anything but EVENT_FOREVER.
+// Input: event, snapshot from Event_Seen, timeout in ms
+// Output: EVENT_POSTED or EVENT_TIMEOUT
+int Event_Wait(Event *ev, unsigned long seen, unsigned long ms);
+
+#endif //  __EVENT_H__
@@ -31,6 +31,57 @@
 long StartCritical (void);    // previous I bit, disable interrupts
 void EndCritical(long sr);    // restore I bit to previous value
 
+// compile-time check, fails to compile with a negative array size
+// when COND is false; MSG names the typedef so the error is readable
+#define FIFO_STATIC_ASSERT(COND,MSG) typedef char MSG[(COND) ? 1 : -1]
+// SIZE is a nonzero power of 2 that Size() can still report
+#define FIFO_POWER_OF_2(SIZE) (((SIZE) > 0) && ((SIZE) <= 0x8000) && (((SIZE)&((SIZE)-1)) == 0))
+
+// Optional per-FIFO counters, compiled in when FIFO_STATS is defined
+// for the whole project.  Each FIFO created by AddIndexFifo or
+// AddPointerFifo then also gets NAME##Fifo_Stats(&snapshot) and
+// NAME##Fifo_ResetStats().  Without FIFO_STATS the counter updates
+// expand to nothing and the functions do not exist.
+// Put/PutBlock calls that cannot store everything count as PutFails,
+// Get/GetBlock calls that find the FIFO empty count as GetFails, so a
+// caller spinning on a full or empty FIFO counts every retry.  The span
+// calls count the same way: a Reserve that gets no room at all because
+// the FIFO is full is a PutFail (a span cut short by the wrap point or
+// by a nearly full FIFO is not), and a Peek on an empty FIFO a GetFail.
+#ifdef FIFO_STATS
+typedef struct{
+  unsigned long PeakSize;   // high-water mark, most elements ever stored
+  unsigned long PutFails;   // puts refused (or cut short) because full
+  unsigned long GetFails;   // gets on an empty FIFO
+  unsigned long Moved;      // total elements successfully put
+} FifoStats;
+#define FIFO_STATS_DECL(NAME)           \
+FifoStats static NAME ## Stats;         \
+void NAME ## Fifo_Stats(FifoStats *pt){ long sr; \
+  sr = StartCritical();                 \
+  *pt = NAME ## Stats;                  \
+  EndCritical(sr);                      \
+}                                       \
+void NAME ## Fifo_ResetStats(void){ long sr; \
+  sr = StartCritical();                 \
+  FIFO_STATS_CLEAR(NAME);               \
+  EndCritical(sr);                      \
+}
+#define FIFO_STATS_CLEAR(NAME)          {NAME ## Stats.PeakSize = NAME ## Stats.PutFails = 0; \
+                                         NAME ## Stats.GetFails = NAME ## Stats.Moved = 0;}
+#define FIFO_STATS_PUT(NAME,N,SIZENOW)  {NAME ## Stats.Moved += (N);  \
+                                         if((unsigned long)(SIZENOW) > NAME ## Stats.PeakSize){ \
+                                           NAME ## Stats.PeakSize = (unsigned long)(SIZENOW); }}
+#define FIFO_STATS_PUTFAIL(NAME)        (NAME ## Stats.PutFails++)
+#define FIFO_STATS_GETFAIL(NAME)        (NAME ## Stats.GetFails++)
+#else
+#define FIFO_STATS_DECL(NAME)
+#define FIFO_STATS_CLEAR(NAME)          ((void)0)
+#define FIFO_STATS_PUT(NAME,N,SIZENOW)  ((void)0)
+#define FIFO_STATS_PUTFAIL(NAME)        ((void)0)
+#define FIFO_STATS_GETFAIL(NAME)        ((void)0)
+#endif
+
 // Two-index implementation of the transmit FIFO
 // can hold 0 to TXFIFOSIZE elements
 #define TXFIFOSIZE 16 // must be a power of 2
@@ -71,48 +122,278 @@ int RxFifo_Get(rxDataType *datapt);
 // 0 to RXFIFOSIZE-1
 unsigned short RxFifo_Size(void);
 
-// macro to create an index FIFO
-#define AddIndexFifo(NAME,SIZE,TYPE,SUCCESS,FAIL) \
-unsigned long volatile NAME ## PutI;    \
-unsigned long volatile NAME ## GetI;    \
-TYPE static NAME ## Fifo [SIZE];        \
-void NAME ## Fifo_Init(void){ long sr;  \
-  sr = StartCritical();                 \
-  NAME ## PutI = NAME ## GetI = 0;      \
-  EndCritical(sr);                      \
-}                                       \
+// functions shared by every index FIFO, SIZE is the capacity
+// (a compile-time constant or, for arena FIFOs, a variable)
+#define FIFO_INDEX_BODY(NAME,SIZE,TYPE,SUCCESS,FAIL) \
 int NAME ## Fifo_Put (TYPE data){       \
   if(( NAME ## PutI - NAME ## GetI ) & ~(SIZE-1)){  \
+    FIFO_STATS_PUTFAIL(NAME);           \
     return(FAIL);      \
   }                    \
   NAME ## Fifo[ NAME ## PutI &(SIZE-1)] = data; \
-  NAME ## PutI ## ++;  \
+  NAME ## PutI++;      \
+  FIFO_STATS_PUT(NAME, 1, NAME ## PutI - NAME ## GetI); \
   return(SUCCESS);     \
 }                      \
 int NAME ## Fifo_Get (TYPE *datapt){  \
   if( NAME ## PutI == NAME ## GetI ){ \
+    FIFO_STATS_GETFAIL(NAME);         \
     return(FAIL);      \
   }                    \
   *datapt = NAME ## Fifo[ NAME ## GetI &(SIZE-1)];  \
-  NAME ## GetI ## ++;  \
+  NAME ## GetI++;      \
   return(SUCCESS);     \
 }                      \
+int NAME ## Fifo_PutOverwrite (TYPE data){ long sr; \
+  int status = SUCCESS;                 \
+  sr = StartCritical();                 \
+  if(( NAME ## PutI - NAME ## GetI ) & ~(SIZE-1)){  \
+    NAME ## GetI++;                     \
+    NAME ## Dropped++;                  \
+    status = FAIL;                      \
+  }                                     \
+  NAME ## Fifo[ NAME ## PutI &(SIZE-1)] = data; \
+  NAME ## PutI++;                       \
+  FIFO_STATS_PUT(NAME, 1, NAME ## PutI - NAME ## GetI); \
+  EndCritical(sr);                      \
+  return(status);                       \
+}                                       \
+unsigned long NAME ## Fifo_Dropped (void){ \
+  return NAME ## Dropped;               \
+}                                       \
 unsigned short NAME ## Fifo_Size (void){  \
  return ((unsigned short)( NAME ## PutI - NAME ## GetI ));  \
+}                      \
+unsigned short NAME ## Fifo_PutBlock (const TYPE *data, unsigned short n){ \
+  unsigned long putI = NAME ## PutI;    \
+  unsigned long room, i, first;         \
+  room = SIZE - (putI - NAME ## GetI);  \
+  if(n > room){                         \
+    FIFO_STATS_PUTFAIL(NAME);           \
+    n = (unsigned short)room;           \
+  }                                     \
+  first = SIZE - (putI&(SIZE-1));       \
+  if(first > n){                        \
+    first = n;                          \
+  }                                     \
+  for(i=0; i<first; i++){               \
+    NAME ## Fifo[(putI&(SIZE-1))+i] = data[i]; \
+  }                                     \
+  for(; i<n; i++){                      \
+    NAME ## Fifo[i-first] = data[i];    \
+  }                                     \
+  NAME ## PutI = putI + n;              \
+  FIFO_STATS_PUT(NAME, n, putI + n - NAME ## GetI); \
+  return(n);                            \
+}                                       \
+unsigned short NAME ## Fifo_GetBlock (TYPE *datapt, unsigned short n){ \
+  unsigned long getI = NAME ## GetI;    \
+  unsigned long count, i, first;        \
+  count = NAME ## PutI - getI;          \
+  if(count == 0){                       \
+    FIFO_STATS_GETFAIL(NAME);           \
+  }                                     \
+  if(n > count){                        \
+    n = (unsigned short)count;          \
+  }                                     \
+  first = SIZE - (getI&(SIZE-1));       \
+  if(first > n){                        \
+    first = n;                          \
+  }                                     \
+  for(i=0; i<first; i++){               \
+    datapt[i] = NAME ## Fifo[(getI&(SIZE-1))+i]; \
+  }                                     \
+  for(; i<n; i++){                      \
+    datapt[i] = NAME ## Fifo[i-first];  \
+  }                                     \
+  NAME ## GetI = getI + n;              \
+  return(n);                            \
+}                                       \
+TYPE *NAME ## Fifo_Reserve (unsigned short *n){ \
+  unsigned long putI = NAME ## PutI;    \
+  unsigned long room;                   \
+  room = SIZE - (putI - NAME ## GetI);  \
+  if((room == 0) && *n){                \
+    FIFO_STATS_PUTFAIL(NAME);           \
+  }                                     \
+  if(room > SIZE - (putI&(SIZE-1))){    \
+    room = SIZE - (putI&(SIZE-1));      \
+  }                                     \
+  if(*n > room){                        \
+    *n = (unsigned short)room;          \
+  }                                     \
+  return(&NAME ## Fifo[putI&(SIZE-1)]); \
+}                                       \
+void NAME ## Fifo_Commit (unsigned short n){ \
+  NAME ## PutI = NAME ## PutI + n;      \
+  FIFO_STATS_PUT(NAME, n, NAME ## PutI - NAME ## GetI); \
+}                                       \
+TYPE *NAME ## Fifo_Peek (unsigned short *n){ \
+  unsigned long getI = NAME ## GetI;    \
+  unsigned long count;                  \
+  count = NAME ## PutI - getI;          \
+  if((count == 0) && *n){               \
+    FIFO_STATS_GETFAIL(NAME);           \
+  }                                     \
+  if(count > SIZE - (getI&(SIZE-1))){   \
+    count = SIZE - (getI&(SIZE-1));     \
+  }                                     \
+  if(*n > count){                       \
+    *n = (unsigned short)count;         \
+  }                                     \
+  return(&NAME ## Fifo[getI&(SIZE-1)]); \
+}                                       \
+void NAME ## Fifo_Consume (unsigned short n){ \
+  NAME ## GetI = NAME ## GetI + n;      \
 }
+
+// macro to create an index FIFO
+#define AddIndexFifo(NAME,SIZE,TYPE,SUCCESS,FAIL) \
+FIFO_STATIC_ASSERT(FIFO_POWER_OF_2(SIZE), NAME ## Fifo_SIZE_must_be_a_power_of_2); \
+unsigned long volatile NAME ## PutI;    \
+unsigned long volatile NAME ## GetI;    \
+unsigned long volatile static NAME ## Dropped; \
+TYPE static NAME ## Fifo [SIZE];        \
+FIFO_STATS_DECL(NAME)                   \
+void NAME ## Fifo_Init(void){ long sr;  \
+  sr = StartCritical();                 \
+  NAME ## PutI = NAME ## GetI = 0;      \
+  NAME ## Dropped = 0;                  \
+  FIFO_STATS_CLEAR(NAME);               \
+  EndCritical(sr);                      \
+}                                       \
+FIFO_INDEX_BODY(NAME,SIZE,TYPE,SUCCESS,FAIL)
 // e.g.,
 // AddIndexFifo(Tx,32,unsigned char, 1,0)
-// SIZE must be a power of two
+// SIZE must be a power of two (checked at compile time)
 // creates TxFifo_Init() TxFifo_Get() and TxFifo_Put()
+// TxFifo_PutBlock() and TxFifo_GetBlock() move up to n elements
+//   in at most two pieces (split at the wrap point) and update the
+//   index once; they return the number of elements actually moved
+// TxFifo_Reserve(&n) returns a contiguous writable span in the FIFO
+//   and lowers n to the space granted (up to the wrap point); the
+//   producer fills it in place and publishes it with TxFifo_Commit(n)
+// TxFifo_Peek(&n) returns a contiguous readable span and lowers n to
+//   the elements available; the consumer frees it with TxFifo_Consume(n)
+// TxFifo_PutOverwrite() is the lossy Put for streams where the newest
+//   data matters most: it never fails for lack of room, when the FIFO
+//   is full it drops the oldest element to make space, counts it in
+//   TxFifo_Dropped() and returns FAIL (the new element is still stored)
+//   It runs with interrupts disabled, so a producer in main and a
+//   consumer in an ISR (or the other way round) stay consistent; a
+//   consumer preempted between reading GetI and the data may see the
+//   newest element in place of the one that was dropped
+
+// Fixed static arena that FIFOs sized at init time are carved out of.
+// FIFO_ARENA_SIZE bytes are reserved once (override it for the whole
+// project); allocations are word aligned and never freed.
+#ifndef FIFO_ARENA_SIZE
+#define FIFO_ARENA_SIZE 512
+#endif
+// allocate bytes from the arena
+// returns 0 (and allocates nothing) if the budget would be exceeded
+void *FifoArena_Alloc(unsigned long bytes);
+// total bytes committed to FIFOs so far, 0 to FIFO_ARENA_SIZE
+unsigned long FifoArena_Used(void);
+
+// macro to create an index FIFO whose size is chosen at init time
+// and whose storage comes from the FIFO arena
+#define AddArenaFifo(NAME,TYPE,SUCCESS,FAIL) \
+unsigned long volatile NAME ## PutI;    \
+unsigned long volatile NAME ## GetI;    \
+unsigned long volatile static NAME ## Dropped; \
+TYPE static *NAME ## Fifo;              \
+unsigned long static NAME ## Cap;       \
+FIFO_STATS_DECL(NAME)                   \
+int NAME ## Fifo_Init(unsigned short size){ long sr; \
+  if( NAME ## Fifo == 0 ){              \
+    if(!FIFO_POWER_OF_2(size)){         \
+      return(FAIL);                     \
+    }                                   \
+    NAME ## Fifo = (TYPE *)FifoArena_Alloc(size*sizeof(TYPE)); \
+    if( NAME ## Fifo == 0 ){            \
+      return(FAIL);                     \
+    }                                   \
+    NAME ## Cap = size;                 \
+  }                                     \
+  else if( NAME ## Cap != size ){       \
+    return(FAIL);                       \
+  }                                     \
+  sr = StartCritical();                 \
+  NAME ## PutI = NAME ## GetI = 0;      \
+  NAME ## Dropped = 0;                  \
+  FIFO_STATS_CLEAR(NAME);               \
+  EndCritical(sr);                      \
+  return(SUCCESS);                      \
+}                                       \
+unsigned short NAME ## Fifo_Capacity (void){ \
+  return ((unsigned short) NAME ## Cap); \
+}                                       \
+FIFO_INDEX_BODY(NAME,NAME ## Cap,TYPE,SUCCESS,FAIL)
+// e.g.,
+// AddArenaFifo(Radio,unsigned char, 1,0)
+// creates RadioFifo_Init(size) which takes size elements (a power of
+//   two) from the arena on the first call and returns FAIL if size is
+//   not a power of two, the arena is out of room, or a later call asks
+//   for a different size; otherwise it empties the FIFO like any Init
+// RadioFifo_Capacity() returns the size given to Init
+// the other functions are the same as AddIndexFifo
+
+// table of the functions of one char FIFO made by AddArenaFifo, so a
+// driver can be handed its FIFOs at run time (one table per FIFO, in ROM)
+typedef struct{
+  int (*Init)(unsigned short size);
+  int (*Put)(char data);
+  int (*Get)(char *datapt);
+  unsigned short (*Size)(void);
+  unsigned short (*Capacity)(void);
+  unsigned short (*PutBlock)(const char *data, unsigned short n);
+  unsigned short (*GetBlock)(char *datapt, unsigned short n);
+  char *(*Reserve)(unsigned short *n);
+  void (*Commit)(unsigned short n);
+  char *(*Peek)(unsigned short *n);
+  void (*Consume)(unsigned short n);
+  int (*PutOverwrite)(char data);
+  unsigned long (*Dropped)(void);
+#ifdef FIFO_STATS
+  void (*Stats)(FifoStats *pt);
+  void (*ResetStats)(void);
+#endif
+} CharFifoOps;
+#ifdef FIFO_STATS
+#define FIFO_OPS_STATS(NAME) , NAME ## Fifo_Stats, NAME ## Fifo_ResetStats
+#else
+#define FIFO_OPS_STATS(NAME)
+#endif
+// macro to create the table for a char FIFO made by AddArenaFifo
+#define AddCharFifoOps(NAME)            \
+const CharFifoOps NAME ## Fifo_Ops = {  \
+  NAME ## Fifo_Init, NAME ## Fifo_Put, NAME ## Fifo_Get, \
+  NAME ## Fifo_Size, NAME ## Fifo_Capacity, \
+  NAME ## Fifo_PutBlock, NAME ## Fifo_GetBlock, \
+  NAME ## Fifo_Reserve, NAME ## Fifo_Commit, \
+  NAME ## Fifo_Peek, NAME ## Fifo_Consume, \
+  NAME ## Fifo_PutOverwrite, NAME ## Fifo_Dropped \
+  FIFO_OPS_STATS(NAME)                  \
+};
+// e.g.,
+// AddArenaFifo(Radio,char, 1,0)
+// AddCharFifoOps(Radio)
+// creates RadioFifo_Ops, RadioFifo_Ops.Put('a') is RadioFifo_Put('a')
 
 // macro to create a pointer FIFO
 #define AddPointerFifo(NAME,SIZE,TYPE,SUCCESS,FAIL) \
+FIFO_STATIC_ASSERT(((SIZE) > 1) && ((SIZE) <= 0x8000), NAME ## Fifo_SIZE_out_of_range); \
 TYPE volatile *NAME ## PutPt;    \
 TYPE volatile *NAME ## GetPt;    \
+unsigned long volatile static NAME ## Dropped; \
 TYPE static NAME ## Fifo [SIZE];        \
+FIFO_STATS_DECL(NAME)                   \
 void NAME ## Fifo_Init(void){ long sr;  \
   sr = StartCritical();                 \
   NAME ## PutPt = NAME ## GetPt = &NAME ## Fifo[0]; \
+  NAME ## Dropped = 0;                  \
+  FIFO_STATS_CLEAR(NAME);               \
   EndCritical(sr);                      \
 }                                       \
 int NAME ## Fifo_Put (TYPE data){       \
@@ -122,19 +403,48 @@ int NAME ## Fifo_Put (TYPE data){       \
     nextPutPt = &NAME ## Fifo[0];       \
   }                                     \
   if(nextPutPt == NAME ## GetPt ){      \
+    FIFO_STATS_PUTFAIL(NAME);           \
     return(FAIL);                       \
   }                                     \
   else{                                 \
     *( NAME ## PutPt ) = data;          \
     NAME ## PutPt = nextPutPt;          \
+    FIFO_STATS_PUT(NAME, 1, (nextPutPt >= NAME ## GetPt) ? \
+      (nextPutPt - NAME ## GetPt) : (nextPutPt - NAME ## GetPt + SIZE)); \
     return(SUCCESS);                    \
   }                                     \
 }                                       \
+int NAME ## Fifo_PutOverwrite (TYPE data){ long sr; \
+  TYPE volatile *nextPutPt;             \
+  int status = SUCCESS;                 \
+  sr = StartCritical();                 \
+  nextPutPt = NAME ## PutPt + 1;        \
+  if(nextPutPt == &NAME ## Fifo[SIZE]){ \
+    nextPutPt = &NAME ## Fifo[0];       \
+  }                                     \
+  if(nextPutPt == NAME ## GetPt ){      \
+    if(++NAME ## GetPt == &NAME ## Fifo[SIZE]){ \
+      NAME ## GetPt = &NAME ## Fifo[0]; \
+    }                                   \
+    NAME ## Dropped++;                  \
+    status = FAIL;                      \
+  }                                     \
+  *( NAME ## PutPt ) = data;            \
+  NAME ## PutPt = nextPutPt;            \
+  FIFO_STATS_PUT(NAME, 1, (nextPutPt >= NAME ## GetPt) ? \
+    (nextPutPt - NAME ## GetPt) : (nextPutPt - NAME ## GetPt + SIZE)); \
+  EndCritical(sr);                      \
+  return(status);                       \
+}                                       \
+unsigned long NAME ## Fifo_Dropped (void){ \
+  return NAME ## Dropped;               \
+}                                       \
 int NAME ## Fifo_Get (TYPE *datapt){    \
   if( NAME ## PutPt == NAME ## GetPt ){ \
+    FIFO_STATS_GETFAIL(NAME);           \
     return(FAIL);                       \
   }                                     \
-  *datapt = *( NAME ## GetPt ## ++);    \
+  *datapt = *( NAME ## GetPt++);         \
   if( NAME ## GetPt == &NAME ## Fifo[SIZE]){ \
     NAME ## GetPt = &NAME ## Fifo[0];   \
   }                                     \
@@ -142,13 +452,276 @@ int NAME ## Fifo_Get (TYPE *datapt){    \
 }                                       \
 unsigned short NAME ## Fifo_Size (void){\
   if( NAME ## PutPt < NAME ## GetPt ){  \
-    return ((unsigned short)( NAME ## PutPt - NAME ## GetPt + (SIZE*sizeof(TYPE)))/sizeof(TYPE)); \
+    return ((unsigned short)( NAME ## PutPt - NAME ## GetPt + SIZE)); \
+  }                                     \
+  return ((unsigned short)( NAME ## PutPt - NAME ## GetPt )); \
+}                                       \
+unsigned short NAME ## Fifo_PutBlock (const TYPE *data, unsigned short n){ \
+  TYPE volatile *putPt = NAME ## PutPt; \
+  TYPE volatile *getPt = NAME ## GetPt; \
+  unsigned short room, i, first;        \
+  if(putPt < getPt){                    \
+    room = (unsigned short)(getPt - putPt - 1); \
+  }                                     \
+  else{                                 \
+    room = (unsigned short)(SIZE - 1 - (putPt - getPt)); \
+  }                                     \
+  if(n > room){                         \
+    FIFO_STATS_PUTFAIL(NAME);           \
+    n = room;                           \
+  }                                     \
+  first = (unsigned short)(&NAME ## Fifo[SIZE] - putPt); \
+  if(first > n){                        \
+    first = n;                          \
+  }                                     \
+  for(i=0; i<first; i++){               \
+    putPt[i] = data[i];                 \
+  }                                     \
+  for(; i<n; i++){                      \
+    NAME ## Fifo[i-first] = data[i];    \
+  }                                     \
+  putPt = putPt + n;                    \
+  if(putPt >= &NAME ## Fifo[SIZE]){     \
+    putPt = putPt - SIZE;               \
+  }                                     \
+  NAME ## PutPt = putPt;                \
+  FIFO_STATS_PUT(NAME, n, SIZE - 1 - room + n); \
+  return(n);                            \
+}                                       \
+unsigned short NAME ## Fifo_GetBlock (TYPE *datapt, unsigned short n){ \
+  TYPE volatile *putPt = NAME ## PutPt; \
+  TYPE volatile *getPt = NAME ## GetPt; \
+  unsigned short count, i, first;       \
+  if(putPt < getPt){                    \
+    count = (unsigned short)(putPt - getPt + SIZE); \
+  }                                     \
+  else{                                 \
+    count = (unsigned short)(putPt - getPt); \
+  }                                     \
+  if(count == 0){                       \
+    FIFO_STATS_GETFAIL(NAME);           \
+  }                                     \
+  if(n > count){                        \
+    n = count;                          \
+  }                                     \
+  first = (unsigned short)(&NAME ## Fifo[SIZE] - getPt); \
+  if(first > n){                        \
+    first = n;                          \
+  }                                     \
+  for(i=0; i<first; i++){               \
+    datapt[i] = getPt[i];               \
+  }                                     \
+  for(; i<n; i++){                      \
+    datapt[i] = NAME ## Fifo[i-first];  \
+  }                                     \
+  getPt = getPt + n;                    \
+  if(getPt >= &NAME ## Fifo[SIZE]){     \
+    getPt = getPt - SIZE;               \
   }                                     \
-  return ((unsigned short)( NAME ## PutPt - NAME ## GetPt )/sizeof(TYPE)); \
+  NAME ## GetPt = getPt;                \
+  return(n);                            \
 }
 // e.g.,
 // AddPointerFifo(Rx,32,unsigned char, 1,0)
 // SIZE can be any size
 // creates RxFifo_Init() RxFifo_Get() and RxFifo_Put()
+// RxFifo_PutBlock() and RxFifo_GetBlock() move up to n elements
+//   in at most two pieces and update the pointer once
+// RxFifo_PutOverwrite() and RxFifo_Dropped() behave as for AddIndexFifo
+
+// Memory ordering for the single-producer single-consumer FIFO below.
+// volatile alone keeps the compiler from caching the indices, which is
+// enough between one ISR and main on the Cortex-M3, but it does not stop
+// the data store and the index store from being reordered by the
+// compiler or by a write buffer on other cores.  A producer publishes
+// its index with a release store after writing the data; the consumer
+// reads it with an acquire load before reading the data (and vice versa).
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+#define FIFO_INDEX                  _Atomic unsigned long
+#define FIFO_POINTER(TYPE)          TYPE * _Atomic
+#define FIFO_LOAD_RELAXED(DST,SRC)  DST = atomic_load_explicit(&(SRC), memory_order_relaxed)
+#define FIFO_LOAD_ACQUIRE(DST,SRC)  DST = atomic_load_explicit(&(SRC), memory_order_acquire)
+#define FIFO_STORE_RELEASE(DST,VAL) atomic_store_explicit(&(DST), (VAL), memory_order_release)
+#else
+#if defined(__CC_ARM)
+#define FIFO_BARRIER()              __dmb(0xF)          // data memory barrier
+#elif defined(__GNUC__)
+#define FIFO_BARRIER()              __sync_synchronize()
+#else
+#define FIFO_BARRIER()                                  // single core, no write buffer
+#endif
+#define FIFO_INDEX                  unsigned long volatile
+#define FIFO_POINTER(TYPE)          TYPE * volatile
+#define FIFO_LOAD_RELAXED(DST,SRC)  DST = (SRC)
+#define FIFO_LOAD_ACQUIRE(DST,SRC)  do{ DST = (SRC); FIFO_BARRIER(); }while(0)
+#define FIFO_STORE_RELEASE(DST,VAL) do{ FIFO_BARRIER(); DST = (VAL); }while(0)
+#endif
+#ifndef FIFO_CACHELINE
+#define FIFO_CACHELINE 64     // bytes kept between producer and consumer fields
+#endif
+
+// macro to create a lock-free single-producer single-consumer FIFO
+// The producer fields (PutI and its cached copy of GetI) and the consumer
+// fields (GetI and its cached copy of PutI) are a cache line apart so the
+// two sides never write the same line.  Each side only reloads the other
+// side's index when its cached copy says the FIFO is full (or empty).
+#define AddSPSCFifo(NAME,SIZE,TYPE,SUCCESS,FAIL) \
+FIFO_STATIC_ASSERT(FIFO_POWER_OF_2(SIZE), NAME ## Fifo_SIZE_must_be_a_power_of_2); \
+static struct {                         \
+  FIFO_INDEX PutI;          /* written by producer only */ \
+  unsigned long GetICache;  /* producer's copy of GetI */  \
+  char pad1[FIFO_CACHELINE];            \
+  FIFO_INDEX GetI;          /* written by consumer only */ \
+  unsigned long PutICache;  /* consumer's copy of PutI */  \
+  char pad2[FIFO_CACHELINE];            \
+  TYPE Fifo[SIZE];                      \
+} NAME ## Spsc;                         \
+void NAME ## Fifo_Init(void){          \
+  NAME ## Spsc.GetICache = NAME ## Spsc.PutICache = 0; \
+  FIFO_STORE_RELEASE(NAME ## Spsc.PutI, 0); \
+  FIFO_STORE_RELEASE(NAME ## Spsc.GetI, 0); \
+}                                       \
+int NAME ## Fifo_Put (TYPE data){       \
+  unsigned long putI;                   \
+  FIFO_LOAD_RELAXED(putI, NAME ## Spsc.PutI); \
+  if((putI - NAME ## Spsc.GetICache) >= SIZE){ \
+    FIFO_LOAD_ACQUIRE(NAME ## Spsc.GetICache, NAME ## Spsc.GetI); \
+    if((putI - NAME ## Spsc.GetICache) >= SIZE){ \
+      return(FAIL);                     \
+    }                                   \
+  }                                     \
+  NAME ## Spsc.Fifo[putI&(SIZE-1)] = data; \
+  FIFO_STORE_RELEASE(NAME ## Spsc.PutI, putI+1); \
+  return(SUCCESS);                      \
+}                                       \
+int NAME ## Fifo_Get (TYPE *datapt){    \
+  unsigned long getI;                   \
+  FIFO_LOAD_RELAXED(getI, NAME ## Spsc.GetI); \
+  if(getI == NAME ## Spsc.PutICache){   \
+    FIFO_LOAD_ACQUIRE(NAME ## Spsc.PutICache, NAME ## Spsc.PutI); \
+    if(getI == NAME ## Spsc.PutICache){ \
+      return(FAIL);                     \
+    }                                   \
+  }                                     \
+  *datapt = NAME ## Spsc.Fifo[getI&(SIZE-1)]; \
+  FIFO_STORE_RELEASE(NAME ## Spsc.GetI, getI+1); \
+  return(SUCCESS);                      \
+}                                       \
+unsigned short NAME ## Fifo_Size (void){ \
+  unsigned long putI, getI;             \
+  FIFO_LOAD_ACQUIRE(getI, NAME ## Spsc.GetI); \
+  FIFO_LOAD_ACQUIRE(putI, NAME ## Spsc.PutI); \
+  return ((unsigned short)(putI - getI)); \
+}                                       \
+unsigned short NAME ## Fifo_PutBlock (const TYPE *data, unsigned short n){ \
+  unsigned long putI, room, i;          \
+  FIFO_LOAD_RELAXED(putI, NAME ## Spsc.PutI); \
+  room = SIZE - (putI - NAME ## Spsc.GetICache); \
+  if(n > room){                         \
+    FIFO_LOAD_ACQUIRE(NAME ## Spsc.GetICache, NAME ## Spsc.GetI); \
+    room = SIZE - (putI - NAME ## Spsc.GetICache); \
+    if(n > room) n = (unsigned short)room; \
+  }                                     \
+  for(i=0; i<n; i++){                   \
+    NAME ## Spsc.Fifo[(putI+i)&(SIZE-1)] = data[i]; \
+  }                                     \
+  FIFO_STORE_RELEASE(NAME ## Spsc.PutI, putI+n); \
+  return(n);                            \
+}                                       \
+unsigned short NAME ## Fifo_GetBlock (TYPE *datapt, unsigned short n){ \
+  unsigned long getI, i;                \
+  FIFO_LOAD_RELAXED(getI, NAME ## Spsc.GetI); \
+  if((NAME ## Spsc.PutICache - getI) < n){ \
+    FIFO_LOAD_ACQUIRE(NAME ## Spsc.PutICache, NAME ## Spsc.PutI); \
+    if(n > NAME ## Spsc.PutICache - getI){ \
+      n = (unsigned short)(NAME ## Spsc.PutICache - getI); \
+    }                                   \
+  }                                     \
+  for(i=0; i<n; i++){                   \
+    datapt[i] = NAME ## Spsc.Fifo[(getI+i)&(SIZE-1)]; \
+  }                                     \
+  FIFO_STORE_RELEASE(NAME ## Spsc.GetI, getI+n); \
+  return(n);                            \
+}
+// e.g.,
+// AddSPSCFifo(Msg,64,unsigned long, 1,0)
+// SIZE must be a power of two (checked at compile time), FIFO holds 0 to SIZE elements
+// creates MsgFifo_Init() MsgFifo_Put() MsgFifo_Get() MsgFifo_Size()
+//   MsgFifo_PutBlock() and MsgFifo_GetBlock(), same contract as AddIndexFifo
+// exactly one context may call Put/PutBlock and exactly one Get/GetBlock
+// Init must run before either side starts; it uses no critical section,
+//   so the macro builds on a host without StartCritical/EndCritical
+// there is no PutOverwrite, dropping the oldest element would make the
+//   producer write GetI, which belongs to the consumer
+
+// macro to create the pointer form of the single-producer single-consumer
+// FIFO, same layout and ordering as AddSPSCFifo but with PutPt and GetPt
+// Like AddPointerFifo it holds SIZE-1 elements (full when PutPt is one
+// behind GetPt) and SIZE can be any size
+#define AddSPSCPointerFifo(NAME,SIZE,TYPE,SUCCESS,FAIL) \
+FIFO_STATIC_ASSERT(((SIZE) > 1) && ((SIZE) <= 0x8000), NAME ## Fifo_SIZE_out_of_range); \
+static struct {                         \
+  FIFO_POINTER(TYPE) PutPt; /* written by producer only */ \
+  TYPE *GetPtCache;         /* producer's copy of GetPt */ \
+  char pad1[FIFO_CACHELINE];            \
+  FIFO_POINTER(TYPE) GetPt; /* written by consumer only */ \
+  TYPE *PutPtCache;         /* consumer's copy of PutPt */ \
+  char pad2[FIFO_CACHELINE];            \
+  TYPE Fifo[SIZE];                      \
+} NAME ## SpscP;                        \
+void NAME ## Fifo_Init(void){          \
+  NAME ## SpscP.GetPtCache = NAME ## SpscP.PutPtCache = &NAME ## SpscP.Fifo[0]; \
+  FIFO_STORE_RELEASE(NAME ## SpscP.PutPt, &NAME ## SpscP.Fifo[0]); \
+  FIFO_STORE_RELEASE(NAME ## SpscP.GetPt, &NAME ## SpscP.Fifo[0]); \
+}                                       \
+int NAME ## Fifo_Put (TYPE data){       \
+  TYPE *putPt, *nextPt;                 \
+  FIFO_LOAD_RELAXED(putPt, NAME ## SpscP.PutPt); \
+  nextPt = putPt + 1;                   \
+  if(nextPt == &NAME ## SpscP.Fifo[SIZE]){ \
+    nextPt = &NAME ## SpscP.Fifo[0];    \
+  }                                     \
+  if(nextPt == NAME ## SpscP.GetPtCache){ \
+    FIFO_LOAD_ACQUIRE(NAME ## SpscP.GetPtCache, NAME ## SpscP.GetPt); \
+    if(nextPt == NAME ## SpscP.GetPtCache){ \
+      return(FAIL);                     \
+    }                                   \
+  }                                     \
+  *putPt = data;                        \
+  FIFO_STORE_RELEASE(NAME ## SpscP.PutPt, nextPt); \
+  return(SUCCESS);                      \
+}                                       \
+int NAME ## Fifo_Get (TYPE *datapt){    \
+  TYPE *getPt;                          \
+  FIFO_LOAD_RELAXED(getPt, NAME ## SpscP.GetPt); \
+  if(getPt == NAME ## SpscP.PutPtCache){ \
+    FIFO_LOAD_ACQUIRE(NAME ## SpscP.PutPtCache, NAME ## SpscP.PutPt); \
+    if(getPt == NAME ## SpscP.PutPtCache){ \
+      return(FAIL);                     \
+    }                                   \
+  }                                     \
+  *datapt = *getPt;                     \
+  getPt = getPt + 1;                    \
+  if(getPt == &NAME ## SpscP.Fifo[SIZE]){ \
+    getPt = &NAME ## SpscP.Fifo[0];     \
+  }                                     \
+  FIFO_STORE_RELEASE(NAME ## SpscP.GetPt, getPt); \
+  return(SUCCESS);                      \
+}                                       \
+unsigned short NAME ## Fifo_Size (void){ \
+  TYPE *putPt, *getPt;                  \
+  FIFO_LOAD_ACQUIRE(getPt, NAME ## SpscP.GetPt); \
+  FIFO_LOAD_ACQUIRE(putPt, NAME ## SpscP.PutPt); \
+  if(putPt < getPt){                    \
+    return ((unsigned short)(putPt - getPt + SIZE)); \
+  }                                     \
+  return ((unsigned short)(putPt - getPt)); \
+}
+// e.g.,
+// AddSPSCPointerFifo(Msg,100,unsigned long, 1,0)
+// creates MsgFifo_Init() MsgFifo_Put() MsgFifo_Get() MsgFifo_Size()
+// there are no block operations, the index form has them and is the
+//   one to use for bulk transfers
 
 #endif //  __FIFO_H__
@@ -0,0 +1,51 @@
+// Format.h
+// Runs on any LM3Sxxx
+// Number to ASCII conversion into a caller supplied buffer, so a whole
+// number can be sent with one UART_Write instead of one OutChar per
+// digit.  Nothing is allocated and no divide instruction is used:
+// decimal digits come out two at a time from a table of digit pairs,
+// with the quotient by 100 found by multiplying with its reciprocal.
+// Every function NULL-terminates the buffer and returns the number of
+// characters written, not counting the NULL.
+
+#ifndef __FORMAT_H__
+#define __FORMAT_H__
+
+#define FMT_UDECMAX 11  // buffer size for any Fmt_UDec, 10 digits and NULL
+#define FMT_DECMAX  12  // buffer size for any Fmt_Dec, sign, 10 digits and NULL
+#define FMT_UHEXMAX 9   // buffer size for any Fmt_UHex, 8 digits and NULL
+
+//------------Fmt_UDec------------
+// 32-bit unsigned decimal, 1 to 10 digits, no spaces
+// Input: buffer of at least FMT_UDECMAX, number
+// Output: characters written
+unsigned short Fmt_UDec(char *buf, unsigned long n);
+
+//------------Fmt_Dec------------
+// 32-bit signed decimal, '-' then 1 to 10 digits, no spaces
+// Input: buffer of at least FMT_DECMAX, number
+// Output: characters written
+unsigned short Fmt_Dec(char *buf, long n);
+
+//------------Fmt_UHex------------
+// 32-bit unsigned hexadecimal, 1 to 8 digits 0-9 A-F, no '0x'
+// Input: buffer of at least FMT_UHEXMAX, number
+// Output: characters written
+unsigned short Fmt_UHex(char *buf, unsigned long n);
+
+//------------Fmt_UDecWidth------------
+// 32-bit unsigned decimal padded on the left with '0' to width digits
+// A number with more digits than width is written in full
+// Input: buffer of at least width+1 and FMT_UDECMAX, number, width
+// Output: characters written
+unsigned short Fmt_UDecWidth(char *buf, unsigned long n, unsigned short width);
+
+//------------Fmt_Fix------------
+// 32-bit signed fixed-point decimal, the value is n/10^decimals
+// e.g. Fmt_Fix(buf, -1234, 3) writes "-1.234", Fmt_Fix(buf, 5, 2) "0.05"
+// Input: buffer of at least FMT_DECMAX+2, number, digits after the '.'
+//        0 to 10 (0 gives no '.')
+// Output: characters written
+unsigned short Fmt_Fix(char *buf, long n, unsigned short decimals);
+
+#endif
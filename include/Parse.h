@@ -0,0 +1,44 @@
+// Parse.h
+// Runs on any LM3Sxxx
+// ASCII to number conversion of a whole line already in memory, the
+// input side of Format.h.  A line read with UART_InString (or any other
+// NULL-terminated buffer) is parsed at once instead of one InChar and
+// one echo per digit, and a number that does not fit in 32 bits is
+// reported instead of silently wrapping.
+// Every function skips leading spaces and tabs, converts as many digits
+// as it can and returns the number of characters consumed, so several
+// numbers on one line are read by advancing the pointer:
+//   pt = line;
+//   while(pt += Parse_UDec(pt, &value, &status), status == PARSE_OK){
+//     ...use value...
+//   }
+//   // status is PARSE_NONE at the end of the line or on a bad character
+
+#ifndef __PARSE_H__
+#define __PARSE_H__
+
+#define PARSE_OK       0  // a number was converted
+#define PARSE_NONE     1  // no digits, *value is 0 and only blanks were consumed
+#define PARSE_OVERFLOW 2  // out of range, every digit was consumed and
+                          // *value is the closest limit
+
+//------------Parse_UDec------------
+// Unsigned decimal, 0 to 4294967295
+// Input: line, where to store the value and the status
+// Output: characters consumed
+unsigned short Parse_UDec(const char *pt, unsigned long *value, int *status);
+
+//------------Parse_Dec------------
+// Signed decimal with optional '+' or '-', -2147483648 to 2147483647
+// Input: line, where to store the value and the status
+// Output: characters consumed
+unsigned short Parse_Dec(const char *pt, long *value, int *status);
+
+//------------Parse_UHex------------
+// Unsigned hexadecimal, 0 to FFFFFFFF, with an optional "0x" or "0X"
+// upper or lower case digits
+// Input: line, where to store the value and the status
+// Output: characters consumed
+unsigned short Parse_UHex(const char *pt, unsigned long *value, int *status);
+
+#endif
@@ -29,9 +29,15 @@
  http://users.ece.utexas.edu/~valvano/
  */
 
-// Initialize SysTick with busy wait running at bus clock.
+// Initialize SysTick to interrupt every 1 ms running at bus clock.
+// SysTick_Ms() only advances once interrupts are enabled, the busy
+// waits work either way.
 void SysTick_Init(void);
 
+// Milliseconds since SysTick_Init, wraps after about 49 days
+// Compare times by subtraction, (SysTick_Ms()-start) >= timeout
+unsigned long SysTick_Ms(void);
+
 // Time delay using busy wait.
 // The delay parameter is in units of the core clock. (units of 20 nsec for 50 MHz clock)
 void SysTick_Wait(unsigned long delay);
@@ -24,6 +24,13 @@
 
 // U0Rx (VCP receive) connected to PA0
 // U0Tx (VCP transmit) connected to PA1
+// U1Rx (XBee DOUT) connected to PD2
+// U1Tx (XBee DIN) connected to PD3
+// U2Rx connected to PG0
+// U2Tx connected to PG1
+
+#ifndef __UART2_H__
+#define __UART2_H__
 
 // standard ASCII symbols
 #define CR   0x0D
@@ -36,75 +43,282 @@
 extern void EnableInterrupts(void);
 extern void DisableInterrupts(void);
 
-//---------------------OUTCRLF_UART0---------------------
-// Output a CR,LF to UART0 to go to a new line
-// Input: none
+// port numbers, the first parameter of every UART_ function
+#define UART_PORT0 0  // console
+#define UART_PORT1 1  // XBee
+#define UART_PORT2 2
+#define UART_PORTS 3
+
+// default baud rates and software FIFO sizes in bytes (powers of 2)
+// used by UART_Init, the FIFOs are taken from the FIFO arena (see FIFO.h)
+#ifndef UART0_BAUD
+#define UART0_BAUD       9600
+#endif
+#ifndef UART0_RXFIFOSIZE
+#define UART0_RXFIFOSIZE   8  // console input is typed by hand
+#endif
+#ifndef UART0_TXFIFOSIZE
+#define UART0_TXFIFOSIZE  64  // a line of console output
+#endif
+#ifndef UART1_BAUD
+#define UART1_BAUD       9600
+#endif
+#ifndef UART1_RXFIFOSIZE
+#define UART1_RXFIFOSIZE 128  // a full XBee API frame
+#endif
+#ifndef UART1_TXFIFOSIZE
+#define UART1_TXFIFOSIZE 128
+#endif
+#ifndef UART1_TXHIFIFOSIZE
+#define UART1_TXHIFIFOSIZE 32 // high priority control frames
+#endif
+#ifndef UART2_BAUD
+#define UART2_BAUD       9600
+#endif
+#ifndef UART2_RXFIFOSIZE
+#define UART2_RXFIFOSIZE  16
+#endif
+#ifndef UART2_TXFIFOSIZE
+#define UART2_TXFIFOSIZE  32
+#endif
+// line mode buffers, UART_LINES (a power of 2) of UART_LINESIZE bytes
+// each, shared by every port in line mode
+#ifndef UART_LINES
+#define UART_LINES        4
+#endif
+#ifndef UART_LINESIZE
+#define UART_LINESIZE    32  // longest line is UART_LINESIZE-1 characters
+#endif
+// adaptive RX interrupt level, it steps up from 1/8 full after
+// UART_RXADAPT RX interrupts in a row with no receive time-out, to at
+// most UART_RXLEVELMAX (0 1/8, 1 1/4, 2 1/2, 3 3/4, 4 7/8; 0 turns it off)
+// the space left above the level is how long the handler may be held off
+#ifndef UART_RXADAPT
+#define UART_RXADAPT      4
+#endif
+#ifndef UART_RXLEVELMAX
+#define UART_RXLEVELMAX   2   // 8 bytes, still 8 bytes of headroom
+#endif
+// high priority frames sent in a row before a waiting bulk frame gets a turn
+#ifndef UART1_TXSTARVE
+#define UART1_TXSTARVE 4
+#endif
+// optional CTS flow control of UART1, define UART1_CTS for the whole
+// project to turn it on; the XBee drives CTS (DIO7) high when its
+// serial buffer is nearly full, UART1 then stops refilling its
+// hardware TX FIFO until an edge interrupt on the pin sees it low again
+// The default pin is PD4 with GPIOPortD_Handler as its handler; to use
+// another pin define all five, and leave UART1_CTS_HANDLER undefined
+// if that GPIO port's handler is shared (it must call UART1_CtsEdge)
+#ifdef UART1_CTS
+#ifndef UART1_CTS_GPIO
+#define UART1_CTS_GPIO    0x40007000  // GPIO port D
+#define UART1_CTS_RCGC    0x00000008  // its SYSCTL_RCGC2_R bit
+#define UART1_CTS_PIN     0x10        // PD4, XBee pin 12 CTS/DIO7
+#define UART1_CTS_IRQ     3           // its NVIC interrupt number
+#define UART1_CTS_HANDLER GPIOPortD_Handler
+#endif
+#endif
+
+// latency of one UART1 transmit queue, waits are counted in bytes that
+// went out on the wire between queuing a frame and starting to send it
+// (one byte is about 1.04 ms at 9600 baud)
+typedef struct{
+  unsigned long Frames;     // frames sent
+  unsigned long MaxWait;    // longest wait
+  unsigned long TotalWait;  // sum of waits, divide by Frames for the mean
+} TxQueueStats;
+
+// interrupts taken by one UART in a second
+typedef struct{
+  unsigned long Irqs;       // handler entries
+  unsigned long Tx;         // TX FIFO level
+  unsigned long Rx;         // RX FIFO level
+  unsigned long Rt;         // receive time-out
+} UartIrqRate;              // one entry can count in more than one source
+
+//---------------------UART_OutCRLF---------------------
+// Output a CR,LF to the UART to go to a new line
+// Input: port number
 // Output: none
-void OutCRLF_UART0(void);
+void UART_OutCRLF(unsigned char port);
 
-//------------UART0_InChar------------
-// Wait for new serial port input
-// Initialize the UART for 115,200 baud rate (assuming 50 MHz clock),
+//------------UART_Init------------
+// Initialize the UART at its default baud rate with the default
+// software FIFO sizes above
 // 8 bit word length, no parity bits, one stop bit, FIFOs enabled
-// Input: none
-// Output: none
-void UART0_Init(void);
+// Input: port number
+// Output: 1 on success, 0 on failure like UART_InitSizes
+int UART_Init(unsigned char port);
+
+//------------UART_InitSizes------------
+// Initialize the UART like UART_Init but with software FIFOs of
+//   the given sizes, taken from the FIFO arena (see FIFO.h)
+// Input: port number, rxSize, txSize bytes in each FIFO, must be powers of 2
+// Output: 1 on success, 0 if a size is not a power of 2, the arena is
+//   out of room, the sizes differ from the first call or the default
+//   baud rate cannot be made from the bus clock; the UART is not
+//   touched on failure
+int UART_InitSizes(unsigned char port, unsigned short rxSize, unsigned short txSize);
 
-//------------UART0_InChar------------
+//------------UART_InChar------------
 // Wait for new serial port input
-// Input: none
+// Input: port number
 // Output: ASCII code for key typed
-unsigned char UART0_InChar(void);
+unsigned char UART_InChar(unsigned char port);
 
-//------------UART0_OutChar------------
+//------------UART_OutChar------------
 // Output 8-bit to serial port
-// Input: letter is an 8-bit ASCII character to be transferred
+// Input: port number, letter is an 8-bit ASCII character to be transferred
 // Output: none
-void UART0_OutChar(unsigned char data);
+void UART_OutChar(unsigned char port, unsigned char data);
 
-//------------UART0_OutString------------
+//------------UART_OutString------------
 // Output String (NULL termination)
-// Input: pointer to a NULL-terminated string to be transferred
+// Input: port number, pointer to a NULL-terminated string to be transferred
+// Output: none
+void UART_OutString(unsigned char port, char *pt);
+
+//------------UART_Write------------
+// Output len bytes, sleeping while the software TX FIFO is full
+// The TX interrupt is masked and unmasked once per FIFO full of data
+// Input: port number, pointer to the bytes (any values, 0 included), count
 // Output: none
-void UART0_OutString(char *pt);
+void UART_Write(unsigned char port, const void *buf, unsigned long len);
+
+//------------UART_TryWrite------------
+// Queue as many of the len bytes as fit right now, without waiting
+// The TX interrupt is masked once for the whole call while the
+// software and hardware TX FIFOs are filled in blocks
+// Input: port number, pointer to the bytes (any values, 0 included), count
+// Output: number of bytes accepted, 0 to len
+unsigned long UART_TryWrite(unsigned char port, const void *buf, unsigned long len);
+
+//------------UART_TxFlush------------
+// Wait until everything queued for the UART has gone to the hardware
+// Input: port number
+// Output: none
+void UART_TxFlush(unsigned char port);
+
+//------------UART_OutCharLossy------------
+// Output 8-bit to serial port without ever waiting, for telemetry
+// If the software TX FIFO is full the oldest unsent byte is dropped
+// Input: port number, letter is an 8-bit ASCII character to be transferred
+// Output: none
+void UART_OutCharLossy(unsigned char port, unsigned char data);
+
+//------------UART_OutStringLossy------------
+// Output String (NULL termination) without ever waiting, for telemetry
+// If the software TX FIFO fills the oldest unsent bytes are dropped
+// Input: port number, pointer to a NULL-terminated string to be transferred
+// Output: none
+void UART_OutStringLossy(unsigned char port, char *pt);
+
+//------------UART_TxDropped------------
+// Number of bytes dropped by the lossy outputs since the UART was initialized
+// Input: port number
+// Output: count of overwritten bytes
+unsigned long UART_TxDropped(unsigned char port);
+
+//------------UART_TxReserve------------
+// Reserve contiguous space in the software TX FIFO so a producer
+//   can build its output in place
+// Input: port number, n points to the number of bytes wanted
+// Output: pointer to the writable span, *n lowered to the bytes granted
+//   (may be 0 when the FIFO is full, less than asked at the wrap point)
+char *UART_TxReserve(unsigned char port, unsigned short *n);
+
+//------------UART_TxReserveWait------------
+// Like UART_TxReserve, but sleeps while the software TX FIFO is full
+// Input: port number, n points to the number of bytes wanted (not 0)
+// Output: pointer to the writable span, *n lowered to the bytes granted
+//   (at least 1, less than asked when the FIFO is nearly full or wraps)
+char *UART_TxReserveWait(unsigned char port, unsigned short *n);
+
+//------------UART_TxCommit------------
+// Queue n bytes written into a UART_TxReserve span and start sending
+// Input: port number, number of bytes written
+// Output: none
+void UART_TxCommit(unsigned char port, unsigned short n);
+
+//------------UART_SetBaud------------
+// Change the baud rate of an initialized UART.  Bytes already queued are
+//   sent at the old rate first, then the UART is disabled, given the new
+//   divisors and enabled again; a byte arriving during the switch is lost
+// Input: port number, bus clock in Hz, baud rate in bits/sec
+// Output: (actual-baud)/baud in units of 0.01%, e.g. 115200 from 50 MHz
+//   is 115207 bits/sec and returns 0; UART_BAUDBAD (rate unchanged) if
+//   clock cannot make that rate
+#define UART_BAUDBAD 0x7FFFFFFF
+long UART_SetBaud(unsigned char port, unsigned long clock, unsigned long baud);
 
-//------------UART0_InUDec------------
+//------------UART_Baud------------
+// Actual baud rate, which differs from the one asked for by the error
+// Input: port number
+// Output: bits/sec
+unsigned long UART_Baud(unsigned char port);
+
+//------------UART_IrqRate------------
+// Interrupts taken by the UART in the last whole second, to see how
+//   much the adaptive RX level saves under load (the second is timed
+//   with SysTick_Ms, so SysTick_Init must have been called)
+// Input: port number, rate points to the structure to fill
+// Output: RX interrupt level now, in eighths of the hardware FIFO
+unsigned char UART_IrqRate(unsigned char port, UartIrqRate *rate);
+
+//------------UART_InUDec------------
 // InUDec accepts ASCII input in unsigned decimal format
 //     and converts to a 32-bit unsigned number
 //     valid range is 0 to 4294967295 (2^32-1)
-// Input: none
+// Input: port number
 // Output: 32-bit unsigned number
-// If you enter a number above 4294967295, it will return an incorrect value
+// The whole line is read first (from UART_InLine in line mode) and
+// converted by Parse_UDec; a number above 4294967295 returns 4294967295
 // Backspace will remove last digit typed
-unsigned long UART0_InUDec(void);
+unsigned long UART_InUDec(unsigned char port);
+
+//------------UART_InUDecStatus------------
+// Like UART_InUDec, but reports a bad or out of range number
+// Input: port number, where to store the number
+// Output: PARSE_OK, PARSE_NONE (no digits, *number is 0) or
+//         PARSE_OVERFLOW (*number is 4294967295), see Parse.h
+int UART_InUDecStatus(unsigned char port, unsigned long *number);
 
-//-----------------------UART0_OutUDec-----------------------
+//-----------------------UART_OutUDec-----------------------
 // Output a 32-bit number in unsigned decimal format
-// Input: 32-bit number to be transferred
+// Input: port number, 32-bit number to be transferred
 // Output: none
 // Variable format 1-10 digits with no space before or after
-void UART0_OutUDec(unsigned long n);
+void UART_OutUDec(unsigned char port, unsigned long n);
 
-//---------------------UART0_InUHex----------------------------------------
+//---------------------UART_InUHex----------------------------------------
 // Accepts ASCII input in unsigned hexadecimal (base 16) format
-// Input: none
+// Input: port number
 // Output: 32-bit unsigned number
 // No '$' or '0x' need be entered, just the 1 to 8 hex digits
 // It will convert lower case a-f to uppercase A-F
 //     and converts to a 16 bit unsigned number
 //     value range is 0 to FFFFFFFF
-// If you enter a number above FFFFFFFF, it will return an incorrect value
+// The whole line is read first (from UART_InLine in line mode) and
+// converted by Parse_UHex; a number above FFFFFFFF returns FFFFFFFF
 // Backspace will remove last digit typed
-unsigned long UART0_InUHex(void);
+unsigned long UART_InUHex(unsigned char port);
+
+//------------UART_InUHexStatus------------
+// Like UART_InUHex, but reports a bad or out of range number
+// Input: port number, where to store the number
+// Output: PARSE_OK, PARSE_NONE (no digits, *number is 0) or
+//         PARSE_OVERFLOW (*number is FFFFFFFF), see Parse.h
+int UART_InUHexStatus(unsigned char port, unsigned long *number);
 
-//--------------------------UART0_OutUHex----------------------------
+//--------------------------UART_OutUHex----------------------------
 // Output a 32-bit number in unsigned hexadecimal format
-// Input: 32-bit number to be transferred
+// Input: port number, 32-bit number to be transferred
 // Output: none
 // Variable format 1 to 8 digits with no space before or after
-void UART0_OutUHex(unsigned long number);
+void UART_OutUHex(unsigned char port, unsigned long number);
 
-//------------UART0_InString------------
+//------------UART_InString------------
 // Accepts ASCII characters from the serial port
 //    and adds them to a string until <enter> is typed
 //    or until max length of the string is reached.
@@ -113,99 +327,300 @@ void UART0_OutUHex(unsigned long number);
 //    and the backspace is echoed
 // terminates the string with a null character
 // uses busy-waiting synchronization on RDRF
-// Input: pointer to empty buffer, size of buffer
+// Input: port number, pointer to empty buffer, size of buffer
 // Output: Null terminated string
 // -- Modified by Agustinus Darmawan + Mingjie Qiu --
-void UART0_InString(char *bufPt, unsigned short max);
+void UART_InString(unsigned char port, char *bufPt, unsigned short max);
+
+// Receive with a time limit, so a device that does not answer cannot
+// hang the caller.  Times are in ms from SysTick_Ms (SysTick_Init must
+// have been called); the Try versions never wait.
+#define UART_OK       1  // the data asked for arrived
+#define UART_TIMEOUT  0  // it did not arrive in time
+#define UART_FOREVER  0xFFFFFFFF  // time limit that never runs out
+
+//------------UART_TryInChar------------
+// Input one character if there is one, without waiting
+// Input: port number, where to store the character
+// Output: UART_OK, or UART_TIMEOUT if the RX FIFO is empty
+int UART_TryInChar(unsigned char port, char *data);
+
+//------------UART_InCharTimeout------------
+// Input one character, sleeping at most ms milliseconds for it
+// Input: port number, where to store the character,
+//        time limit in ms (UART_FOREVER for none)
+// Output: UART_OK, or UART_TIMEOUT if nothing arrived in time
+int UART_InCharTimeout(unsigned char port, char *data, unsigned long ms);
+
+//------------UART_TryRead------------
+// Input up to n bytes that have already arrived, without waiting
+// Input: port number, buffer, its size
+// Output: number of bytes stored, 0 to n
+unsigned short UART_TryRead(unsigned char port, void *buf, unsigned short n);
+
+//------------UART_ReadTimeout------------
+// Input exactly n bytes (any values), sleeping at most ms milliseconds
+// in total for them
+// Input: port number, buffer, its size, time limit in ms (UART_FOREVER for none)
+// Output: number of bytes stored, less than n means it timed out
+unsigned short UART_ReadTimeout(unsigned char port, void *buf, unsigned short n, unsigned long ms);
+
+//------------UART_InStringTimeout------------
+// Input characters up to a CR into a NULL-terminated string, without
+// echo or backspace editing (for replies from a device, not a person),
+// sleeping at most ms milliseconds in total; characters beyond max-1
+// and LF are dropped
+// Input: port number, buffer, its size, time limit in ms (UART_FOREVER for none)
+// Output: UART_OK, or UART_TIMEOUT if no CR arrived in time (the
+//   characters that did are in the buffer)
+int UART_InStringTimeout(unsigned char port, char *bufPt, unsigned short max, unsigned long ms);
+
+// Line mode: the interrupt handler edits input into a line buffer as
+// it arrives (backspace or DEL removes a character, CR, LF or CR LF
+// ends the line, characters past UART_LINESIZE-1 are ignored) and
+// optionally echoes it, so the foreground only sees finished lines and
+// typing is not lost while it is busy.  UART_InChar and the functions
+// built on it get nothing while line mode is on.
+// Echo writes the hardware TX FIFO directly, use it on the console only.
+#define UART_LINE_OFF   0
+#define UART_LINE_ON    1
+#define UART_LINE_ECHO  2  // add to UART_LINE_ON
+
+//------------UART_LineMode------------
+// Turn line mode on or off, an unfinished line is dropped when it
+// is turned off; lines already finished stay queued
+// Input: port number, UART_LINE_OFF, UART_LINE_ON or UART_LINE_ON+UART_LINE_ECHO
+// Output: 1 on success, 0 if the FIFO arena is out of room
+int UART_LineMode(unsigned char port, unsigned char mode);
+
+//------------UART_TryInLine------------
+// Next completed line, without waiting
+// Input: port number
+// Output: pointer to the NULL-terminated line (give it back with
+//   UART_LineRelease), or 0 if no line is ready
+char *UART_TryInLine(unsigned char port);
+
+//------------UART_InLine------------
+// Next completed line, sleeping until one arrives
+// Input: port number
+// Output: pointer to the NULL-terminated line, give it back with UART_LineRelease
+char *UART_InLine(unsigned char port);
+
+//------------UART_InLineTimeout------------
+// Next completed line, sleeping at most ms milliseconds for one
+// Input: port number, time limit in ms (UART_FOREVER for none)
+// Output: pointer to the NULL-terminated line (give it back with
+//   UART_LineRelease), or 0 if none arrived in time
+char *UART_InLineTimeout(unsigned char port, unsigned long ms);
+
+//------------UART_LineRelease------------
+// Give a line from UART_InLine or UART_TryInLine back to the pool
+// Input: pointer returned by UART_InLine or UART_TryInLine
+// Output: none
+void UART_LineRelease(char *line);
+
+//------------UART_LineLost------------
+// Characters dropped in line mode because no line buffer was free
+// Input: port number
+// Output: count since the UART was initialized
+unsigned long UART_LineLost(unsigned char port);
+
+#ifdef UART_PROFILE
+// Handler timing, compiled in when UART_PROFILE is defined for the
+// whole project.  Times are core clock cycles from the DWT cycle
+// counter (20 ns at 50 MHz), which UART_Init starts.
+// Bin k of a histogram counts times of 2^k to 2^(k+1)-1 cycles (bin 0
+// also counts 0), the last bin counts everything longer.
+#define UART_HISTBINS 16
+typedef struct{
+  unsigned long Tx[UART_HISTBINS];      // TX FIFO level work
+  unsigned long Rx[UART_HISTBINS];      // RX FIFO level work
+  unsigned long Rt[UART_HISTBINS];      // receive time-out work
+  unsigned long Handler[UART_HISTBINS]; // whole handler, entry to exit
+  unsigned long MaxHandler;             // longest handler
+  unsigned long MaxRxWait;              // longest from the handler posting RX
+                                        // data to the foreground reading it
+} UartProfile;
+
+//------------UART_Profile------------
+// Snapshot of the handler timing of the UART
+// Input: port number, prof points to the structure to fill
+// Output: none
+void UART_Profile(unsigned char port, UartProfile *prof);
+
+//------------UART_ResetProfile------------
+// Clear the handler timing of the UART
+// Input: port number
+// Output: none
+void UART_ResetProfile(unsigned char port);
+#endif
+
+#ifdef FIFO_STATS
+#include "FIFO.h"
+//------------UART_FifoStats------------
+// Snapshot of the software FIFO counters of the UART, see FIFO.h
+// Input: port number, rx and tx point to the structures to fill
+// Output: none
+void UART_FifoStats(unsigned char port, FifoStats *rx, FifoStats *tx);
+
+//------------UART_ResetFifoStats------------
+// Clear the software FIFO counters of the UART
+// Input: port number
+// Output: none
+void UART_ResetFifoStats(unsigned char port);
+
+//------------UART_RxOverruns------------
+// Number of overrun errors, each one a received byte lost because the
+//   hardware RX FIFO was full, since init or UART_ResetFifoStats
+// Input: port number
+// Output: count of overruns, at most one per handler call
+unsigned long UART_RxOverruns(unsigned char port);
+#endif
+
 //-------------------------------------------------------------------------------------------------------------------------
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // UART1 for XBee
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //-------------------------------------------------------------------------------------------------------------------------
 
-//---------------------OUTCRLF_UART1---------------------
-// Output a CR,LF to UART1 to go to a new line
-// Input: none
-// Output: none
-void OutCRLF_UART1(void);
+//------------UART1_TxBeginFrame------------
+// Mark the next n bytes written to the UART1 TX FIFO (by OutChar,
+//   OutString or TxReserve/TxCommit) as one bulk frame, so that no
+//   high priority frame is sent in the middle of it
+// Input: number of bytes in the frame
+// Output: 1 on success, 0 if too many bulk frames are already waiting
+int UART1_TxBeginFrame(unsigned short n);
 
-//------------UART1_InChar------------
-// Wait for new serial port input
-// Initialize the UART for 115,200 baud rate (assuming 50 MHz clock),
-// 8 bit word length, no parity bits, one stop bit, FIFOs enabled
-// Input: none
+//------------UART1_TxBeginFrameWait------------
+// Like UART1_TxBeginFrame, but sleeps while too many bulk frames are
+//   already waiting
+// Input: number of bytes in the frame
 // Output: none
-void UART1_Init(void);
+void UART1_TxBeginFrameWait(unsigned short n);
 
-//------------UART1_InChar------------
-// Wait for new serial port input
-// Input: none
-// Output: ASCII code for key typed
-unsigned char UART1_InChar(void);
+//------------UART1_TxHiFrame------------
+// Queue a whole frame ahead of the bulk data, it is sent as soon as
+//   the frame being sent now is finished
+// Input: pointer to the frame, number of bytes
+// Output: 1 on success, 0 if it does not fit right now (nothing queued)
+int UART1_TxHiFrame(const char *frame, unsigned short n);
 
-//------------UART1_OutChar------------
-// Output 8-bit to serial port
-// Input: letter is an 8-bit ASCII character to be transferred
-// Output: none
-void UART1_OutChar(unsigned char data);
+//------------UART1_TxHiFrameWait------------
+// Like UART1_TxHiFrame, but sleeps while the frame does not fit
+// Input: pointer to the frame, number of bytes
+// Output: 1 on success, 0 if n is over the high priority ring's
+//   capacity (UART1_TXHIFIFOSIZE) and could never fit
+int UART1_TxHiFrameWait(const char *frame, unsigned short n);
 
-//------------UART1_OutString------------
-// Output String (NULL termination)
-// Input: pointer to a NULL-terminated string to be transferred
+#ifdef UART1_CTS
+//------------UART1_CtsEdge------------
+// Resume UART1 transmission when the XBee asserts CTS, called on
+//   every edge of the CTS pin by UART1_CTS_HANDLER or the application's
+//   handler for that GPIO port, at the same priority as the UARTs
+// Input: none
 // Output: none
-void UART1_OutString(char *pt);
+void UART1_CtsEdge(void);
 
-//------------UART1_InUDec------------
-// InUDec accepts ASCII input in unsigned decimal format
-//     and converts to a 32-bit unsigned number
-//     valid range is 0 to 4294967295 (2^32-1)
+//------------UART1_CtsPauses------------
+// Number of times the XBee has held off UART1 with CTS
 // Input: none
-// Output: 32-bit unsigned number
-// If you enter a number above 4294967295, it will return an incorrect value
-// Backspace will remove last digit typed
-unsigned long UART1_InUDec(void);
+// Output: count since UART1 was initialized
+unsigned long UART1_CtsPauses(void);
+#endif
 
-//-----------------------UART1_OutUDec-----------------------
-// Output a 32-bit number in unsigned decimal format
-// Input: 32-bit number to be transferred
+//------------UART1_TxQueueStats------------
+// Snapshot of the UART1 transmit queue latency counters
+// Input: hi and bulk point to the structures to fill
 // Output: none
-// Variable format 1-10 digits with no space before or after
-void UART1_OutUDec(unsigned long n);
+void UART1_TxQueueStats(TxQueueStats *hi, TxQueueStats *bulk);
 
-//---------------------UART1_InUHex----------------------------------------
-// Accepts ASCII input in unsigned hexadecimal (base 16) format
+//------------UART1_ResetTxQueueStats------------
+// Clear the UART1 transmit queue latency counters
 // Input: none
-// Output: 32-bit unsigned number
-// No '$' or '0x' need be entered, just the 1 to 8 hex digits
-// It will convert lower case a-f to uppercase A-F
-//     and converts to a 16 bit unsigned number
-//     value range is 0 to FFFFFFFF
-// If you enter a number above FFFFFFFF, it will return an incorrect value
-// Backspace will remove last digit typed
-unsigned long UART1_InUHex(void);
-
-//--------------------------UART1_OutUHex----------------------------
-// Output a 32-bit number in unsigned hexadecimal format
-// Input: 32-bit number to be transferred
 // Output: none
-// Variable format 1 to 8 digits with no space before or after
-void UART1_OutUHex(unsigned long number);
+void UART1_ResetTxQueueStats(void);
 
-//------------UART1_InString------------
-// Accepts ASCII characters from the serial port
-//    and adds them to a string until <enter> is typed
-//    or until max length of the string is reached.
-// It echoes each character as it is inputted.
-// If a backspace is inputted, the string is modified
-//    and the backspace is echoed
-// terminates the string with a null character
-// uses busy-waiting synchronization on RDRF
-// Input: pointer to empty buffer, size of buffer
-// Output: Null terminated string
-// -- Modified by Agustinus Darmawan + Mingjie Qiu --
-void UART1_InString(char *bufPt, unsigned short max);
+//-------------------------------------------------------------------------------------------------------------------------
+// Per port names used by the rest of the lab, same as calling the
+// UART_ function above with UART_PORT0 (console) or UART_PORT1 (XBee)
+//-------------------------------------------------------------------------------------------------------------------------
+#define OutCRLF_UART0()            UART_OutCRLF(UART_PORT0)
+#define UART0_Init()               UART_Init(UART_PORT0)
+#define UART0_InitSizes(RX,TX)     UART_InitSizes(UART_PORT0,RX,TX)
+#define UART0_SetBaud(CLOCK,BAUD)  UART_SetBaud(UART_PORT0,CLOCK,BAUD)
+#define UART0_Baud()               UART_Baud(UART_PORT0)
+#define UART0_IrqRate(RATE)        UART_IrqRate(UART_PORT0,RATE)
+#define UART0_InChar()             UART_InChar(UART_PORT0)
+#define UART0_OutChar(DATA)        UART_OutChar(UART_PORT0,DATA)
+#define UART0_OutString(PT)        UART_OutString(UART_PORT0,PT)
+#define UART0_Write(BUF,LEN)       UART_Write(UART_PORT0,BUF,LEN)
+#define UART0_TryWrite(BUF,LEN)    UART_TryWrite(UART_PORT0,BUF,LEN)
+#define UART0_TxFlush()            UART_TxFlush(UART_PORT0)
+#define UART0_OutCharLossy(DATA)   UART_OutCharLossy(UART_PORT0,DATA)
+#define UART0_OutStringLossy(PT)   UART_OutStringLossy(UART_PORT0,PT)
+#define UART0_TxDropped()          UART_TxDropped(UART_PORT0)
+#define UART0_TxReserve(N)         UART_TxReserve(UART_PORT0,N)
+#define UART0_TxReserveWait(N)     UART_TxReserveWait(UART_PORT0,N)
+#define UART0_TxCommit(N)          UART_TxCommit(UART_PORT0,N)
+#define UART0_InUDec()             UART_InUDec(UART_PORT0)
+#define UART0_InUDecStatus(N)      UART_InUDecStatus(UART_PORT0,N)
+#define UART0_OutUDec(N)           UART_OutUDec(UART_PORT0,N)
+#define UART0_InUHex()             UART_InUHex(UART_PORT0)
+#define UART0_InUHexStatus(N)      UART_InUHexStatus(UART_PORT0,N)
+#define UART0_OutUHex(N)           UART_OutUHex(UART_PORT0,N)
+#define UART0_InString(PT,MAX)     UART_InString(UART_PORT0,PT,MAX)
+#define UART0_TryInChar(PT)       UART_TryInChar(UART_PORT0,PT)
+#define UART0_InCharTimeout(PT,MS) UART_InCharTimeout(UART_PORT0,PT,MS)
+#define UART0_TryRead(BUF,N)      UART_TryRead(UART_PORT0,BUF,N)
+#define UART0_ReadTimeout(BUF,N,MS) UART_ReadTimeout(UART_PORT0,BUF,N,MS)
+#define UART0_InStringTimeout(PT,MAX,MS) UART_InStringTimeout(UART_PORT0,PT,MAX,MS)
+#define UART0_LineMode(MODE)       UART_LineMode(UART_PORT0,MODE)
+#define UART0_InLine()             UART_InLine(UART_PORT0)
+#define UART0_TryInLine()          UART_TryInLine(UART_PORT0)
+#define UART0_InLineTimeout(MS)    UART_InLineTimeout(UART_PORT0,MS)
+#define UART0_LineLost()           UART_LineLost(UART_PORT0)
+#define UART0_FifoStats(RX,TX)     UART_FifoStats(UART_PORT0,RX,TX)
+#define UART0_ResetFifoStats()     UART_ResetFifoStats(UART_PORT0)
+#define UART0_RxOverruns()         UART_RxOverruns(UART_PORT0)
+#define UART0_Profile(PROF)        UART_Profile(UART_PORT0,PROF)
+#define UART0_ResetProfile()       UART_ResetProfile(UART_PORT0)
+
+#define OutCRLF_UART1()            UART_OutCRLF(UART_PORT1)
+#define UART1_Init()               UART_Init(UART_PORT1)
+#define UART1_InitSizes(RX,TX)     UART_InitSizes(UART_PORT1,RX,TX)
+#define UART1_SetBaud(CLOCK,BAUD)  UART_SetBaud(UART_PORT1,CLOCK,BAUD)
+#define UART1_Baud()               UART_Baud(UART_PORT1)
+#define UART1_IrqRate(RATE)        UART_IrqRate(UART_PORT1,RATE)
+#define UART1_InChar()             UART_InChar(UART_PORT1)
+#define UART1_OutChar(DATA)        UART_OutChar(UART_PORT1,DATA)
+#define UART1_OutString(PT)        UART_OutString(UART_PORT1,PT)
+#define UART1_Write(BUF,LEN)       UART_Write(UART_PORT1,BUF,LEN)
+#define UART1_TryWrite(BUF,LEN)    UART_TryWrite(UART_PORT1,BUF,LEN)
+#define UART1_TxFlush()            UART_TxFlush(UART_PORT1)
+#define UART1_TxReserve(N)         UART_TxReserve(UART_PORT1,N)
+#define UART1_TxReserveWait(N)     UART_TxReserveWait(UART_PORT1,N)
+#define UART1_TxCommit(N)          UART_TxCommit(UART_PORT1,N)
+#define UART1_InUDec()             UART_InUDec(UART_PORT1)
+#define UART1_InUDecStatus(N)      UART_InUDecStatus(UART_PORT1,N)
+#define UART1_OutUDec(N)           UART_OutUDec(UART_PORT1,N)
+#define UART1_InUHex()             UART_InUHex(UART_PORT1)
+#define UART1_InUHexStatus(N)      UART_InUHexStatus(UART_PORT1,N)
+#define UART1_OutUHex(N)           UART_OutUHex(UART_PORT1,N)
+#define UART1_InString(PT,MAX)     UART_InString(UART_PORT1,PT,MAX)
+#define UART1_TryInChar(PT)       UART_TryInChar(UART_PORT1,PT)
+#define UART1_InCharTimeout(PT,MS) UART_InCharTimeout(UART_PORT1,PT,MS)
+#define UART1_TryRead(BUF,N)      UART_TryRead(UART_PORT1,BUF,N)
+#define UART1_ReadTimeout(BUF,N,MS) UART_ReadTimeout(UART_PORT1,BUF,N,MS)
+#define UART1_InStringTimeout(PT,MAX,MS) UART_InStringTimeout(UART_PORT1,PT,MAX,MS)
+#define UART1_LineMode(MODE)       UART_LineMode(UART_PORT1,MODE)
+#define UART1_InLine()             UART_InLine(UART_PORT1)
+#define UART1_TryInLine()          UART_TryInLine(UART_PORT1)
+#define UART1_InLineTimeout(MS)    UART_InLineTimeout(UART_PORT1,MS)
+#define UART1_LineLost()           UART_LineLost(UART_PORT1)
+#define UART1_FifoStats(RX,TX)     UART_FifoStats(UART_PORT1,RX,TX)
+#define UART1_ResetFifoStats()     UART_ResetFifoStats(UART_PORT1)
+#define UART1_RxOverruns()         UART_RxOverruns(UART_PORT1)
+#define UART1_Profile(PROF)        UART_Profile(UART_PORT1,PROF)
+#define UART1_ResetProfile()       UART_ResetProfile(UART_PORT1)
 
+#endif //  __UART2_H__
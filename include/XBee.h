@@ -1,10 +1,27 @@
 // XBee.h
 
+// XBee interface rate set up by XBee_Init with ATBD, UART1 is switched
+// to it afterwards; one of 1200 2400 4800 9600 19200 38400 57600 115200
+// at 115200 frames move 12 times faster than at the 9600 power-on default
+#ifndef XBEE_BAUD
+#define XBEE_BAUD 9600
+#endif
+// 1 to have XBee_Init save its settings in the XBee with ATWR, so the
+// next boot finds them already there (in API mode at XBEE_BAUD) and
+// skips command mode; 0 leaves the XBee's flash alone
+#ifndef XBEE_SAVE
+#define XBEE_SAVE 0
+#endif
+
 //matt
-void XBee_Init(void);
+// sets up addressing and API mode, with API AT frames if the XBee is
+// already in API mode, else in AT command mode
+// returns 1 on success, 0 if the XBee stopped answering (each command
+// is tried a few times with a time limit, so a missing radio cannot hang it)
+int XBee_Init(void);
 int XBee_TxStatus(void);
 
 //mine
 void XBee_SendTxFrame(void);
-char* XBee_CreateTxFrame(char* string);
+unsigned char XBee_CreateTxFrame(char* string);
 
@@ -0,0 +1,139 @@
+// XBeeApi.h
+// Runs on LM3S1968
+// XBee API mode 1 frames on UART1 (see XBee_Init, ATAP1).  Every frame
+// on the wire is
+//   0x7E, length MSB, length LSB, frame data (API identifier first), checksum
+// where length counts the frame data and the checksum makes the frame
+// data plus checksum add up to 0xFF.
+// Receiving: bytes from UART1 go through a state machine one at a time;
+// each frame with a good checksum is handed to the handler registered
+// for its API identifier.  A bad checksum or an impossible length means
+// the 0x7E it started from was data, so the bytes after it are searched
+// again for the next 0x7E (API mode 1 does not escape 0x7E in the data).
+// Usage, from the main loop instead of blocking on UART1_InString:
+//   XBeeApi_Register(XBEE_API_RX16, rx16Handler);
+//   while(1){
+//     XBeeApi_Poll();           // or XBeeApi_Wait(ms) to sleep for input
+//     ...
+//   }
+// Sending: a TX request is streamed straight into the UART1 transmit
+// FIFO (see UART1_TxReserve) with its checksum added up on the way, so
+// there is no frame buffer and payloads can hold any byte value.
+
+#ifndef __XBEEAPI_H__
+#define __XBEEAPI_H__
+
+#define XBEE_DELIMITER       0x7E
+#define XBEE_PAYLOADMAX      100   // largest RF payload of one TX request
+// API identifiers of frames to the XBee
+#define XBEE_API_TX64        0x00  // send data, 64-bit destination address
+#define XBEE_API_TX16        0x01  // send data, 16-bit destination address
+#define XBEE_API_AT          0x08  // AT command, applied at once
+// API identifiers of frames from the XBee
+#define XBEE_API_RX64        0x80  // data received, 64-bit source address
+#define XBEE_API_RX16        0x81  // data received, 16-bit source address
+#define XBEE_API_ATRESPONSE  0x88  // reply to an AT command frame:
+                                   // API identifier, ID, command (2), status, value
+#define XBEE_API_TXSTATUS    0x89  // result of a TX request
+// TX request options
+#define XBEE_TXOPT_NOACK     0x01  // no acknowledgement, no retries
+#define XBEE_TXOPT_BROADCAST 0x04  // send with the broadcast PAN ID
+
+// longest frame data accepted, an RX 64-bit frame of a full 100-byte
+// RF payload is 111; longer frames are counted and skipped
+#ifndef XBEEAPI_FRAMEMAX
+#define XBEEAPI_FRAMEMAX   128
+#endif
+// longest AT command parameter, NI takes 20 characters; the frame goes
+// whole into the UART1 high priority ring, so 8 more than this must
+// fit in UART1_TXHIFIFOSIZE
+#ifndef XBEEAPI_ATMAX
+#define XBEEAPI_ATMAX       20
+#endif
+// API identifiers that can have a handler at the same time
+#ifndef XBEEAPI_HANDLERS
+#define XBEEAPI_HANDLERS     6
+#endif
+
+// called for each good frame
+// frame points to the frame data (frame[0] is the API identifier),
+// length is the number of frame data bytes; the data is only valid
+// until the handler returns
+typedef void (*XBeeFrameHandler)(const unsigned char *frame, unsigned short length);
+
+typedef struct{
+  unsigned long Frames;       // good frames
+  unsigned long Unhandled;    // good frames with no handler
+  unsigned long BadChecksum;  // frames dropped for their checksum
+  unsigned long BadLength;    // frames dropped for a length of 0 or over XBEEAPI_FRAMEMAX
+  unsigned long Skipped;      // bytes thrown away looking for a 0x7E
+} XBeeApiStats;
+
+//------------XBeeApi_Register------------
+// Set the handler of one API identifier, 0 removes it
+// Input: API identifier, handler
+// Output: 1 on success, 0 if all XBEEAPI_HANDLERS are in use
+int XBeeApi_Register(unsigned char api, XBeeFrameHandler handler);
+
+//------------XBeeApi_Byte------------
+// Run one received byte through the frame state machine, a handler
+// may be called before it returns
+// Input: byte from UART1
+// Output: none
+void XBeeApi_Byte(unsigned char data);
+
+//------------XBeeApi_Poll------------
+// Run every byte UART1 has received so far through XBeeApi_Byte,
+// without waiting
+// Input: none
+// Output: number of good frames handled
+unsigned short XBeeApi_Poll(void);
+
+//------------XBeeApi_Wait------------
+// Like XBeeApi_Poll, but sleeps up to ms milliseconds for the first
+// byte if none has arrived (UART_FOREVER for no limit)
+// Input: time limit in ms
+// Output: number of good frames handled
+unsigned short XBeeApi_Wait(unsigned long ms);
+
+//------------XBeeApi_Tx16------------
+// Queue a TX request to a 16-bit address on UART1, waits while the
+// transmit FIFO is full
+// Input: id        frame ID, 1 to 255, or 0 for no TX status frame
+//        address   16-bit destination address, 0xFFFF for broadcast
+//        options   XBEE_TXOPT_ bits, 0 normally
+//        data      payload, any byte values
+//        length    payload bytes, 0 to XBEE_PAYLOADMAX
+// Output: 1 if queued, 0 (and nothing sent) if length is too big
+int XBeeApi_Tx16(unsigned char id, unsigned short address, unsigned char options,
+                 const void *data, unsigned short length);
+
+//------------XBeeApi_Tx64------------
+// Queue a TX request to a 64-bit address on UART1, like XBeeApi_Tx16
+// Input: address   8 bytes, most significant first
+// Output: 1 if queued, 0 (and nothing sent) if length is too big
+int XBeeApi_Tx64(unsigned char id, const unsigned char *address, unsigned char options,
+                 const void *data, unsigned short length);
+
+//------------XBeeApi_At------------
+// Queue an AT command frame on the UART1 high priority queue
+// (UART1_TxHiFrameWait), ahead of bulk data, sleeping while it is full;
+// the reply comes back as an XBEE_API_ATRESPONSE frame with the same
+// frame ID; no guard times or command mode are needed, and several
+// can be in flight at once
+// Input: id         frame ID, 1 to 255, or 0 for no reply
+//        command    the two letters after AT, e.g. "MY"
+//        parameter  value to set, most significant byte first
+//        length     parameter bytes, 0 to read the setting
+// Output: 1 if queued, 0 (and nothing sent) if length is over
+//         XBEEAPI_ATMAX or the frame is too big for the ring
+int XBeeApi_At(unsigned char id, const char *command,
+               const void *parameter, unsigned short length);
+
+//------------XBeeApi_Stats------------
+// Snapshot of the receive counters
+// Input: stats points to the structure to fill
+// Output: none
+void XBeeApi_Stats(XBeeApiStats *stats);
+
+#endif
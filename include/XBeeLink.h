@@ -0,0 +1,145 @@
+// XBeeLink.h
+// Runs on LM3S1968
+// Windowed transmission of XBee TX 16-bit requests.  Up to
+// XBEELINK_WINDOW frames are in flight at once, each under its own
+// frame ID, instead of sending one frame and idling until its TX status
+// comes back.  Each TX status frame (0x89) is matched to its frame by
+// ID; a frame reported as failed, or with no status after
+// XBEELINK_TIMEOUT ms, is sent again under a new ID, up to
+// XBEELINK_TRIES times in all.  Frames that succeed need nothing more.
+// Each frame keeps a copy of its payload for resending, so the caller's
+// buffer is free as soon as XBeeLink_Send returns.
+// Small messages can be packed together instead (XBeeLink_Queue): each
+// goes into a pending payload as a length byte and its bytes, and the
+// payload is sent as one frame when the next message would not fit or
+// XBEELINK_COALESCE ms after its first message, whichever comes first.
+// One frame then pays the 9 bytes of framing, the RF preamble and the
+// TX status for many messages.  The receiver splits such a payload back
+// into the original messages with XBeeLink_Unpack, or has it done for
+// every RX frame with XBeeLink_Receive.
+// XBeeLink_Init takes over the XBEE_API_TXSTATUS handler (XBeeApi.h),
+// so XBee_TxStatus cannot be used at the same time.
+// Usage, after XBee_Init and SysTick_Init:
+//   XBeeLink_Init();
+//   while(1){
+//     if(message ready) XBeeLink_Send(0x004F, message, n);  // waits if the window is full
+//     if(reading ready) XBeeLink_Queue(0x004F, reading, n); // packed with others
+//     XBeeLink_Poll();          // statuses, resends and received frames
+//   }
+
+#ifndef __XBEELINK_H__
+#define __XBEELINK_H__
+
+// frames in flight at once, each holds a payload copy of XBEE_PAYLOADMAX
+#ifndef XBEELINK_WINDOW
+#define XBEELINK_WINDOW   4
+#endif
+// ms to wait for the TX status of a frame before sending it again
+#ifndef XBEELINK_TIMEOUT
+#define XBEELINK_TIMEOUT  500
+#endif
+// times a frame is sent before it is given up as failed
+#ifndef XBEELINK_TRIES
+#define XBEELINK_TRIES    3
+#endif
+// most ms a queued message waits for others to share its frame
+#ifndef XBEELINK_COALESCE
+#define XBEELINK_COALESCE 50
+#endif
+#define XBEELINK_MSGMAX   (XBEE_PAYLOADMAX-1) // longest queued message
+
+// called for each message unpacked from a received payload
+typedef void (*XBeeMessageHandler)(const unsigned char *message, unsigned char length);
+
+typedef struct{
+  unsigned long Sent;       // frames accepted by XBeeLink_Send
+  unsigned long Messages;   // messages accepted by XBeeLink_Queue
+  unsigned long Delivered;  // frames acknowledged by the destination
+  unsigned long Failed;     // frames given up after XBEELINK_TRIES
+  unsigned long Retries;    // resends, for failures and timeouts
+  unsigned long Timeouts;   // sends with no TX status in XBEELINK_TIMEOUT
+  unsigned long Bytes;      // payload bytes delivered
+  unsigned long Goodput;    // Bytes per second since XBeeLink_Init/ResetStats
+  unsigned long RttMin;     // ms from the last send of a frame to its good status
+  unsigned long RttAvg;
+  unsigned long RttMax;
+} XBeeLinkStats;
+
+//------------XBeeLink_Init------------
+// Empty the window, clear the statistics and handle TX status frames
+// Input: none
+// Output: none
+void XBeeLink_Init(void);
+
+//------------XBeeLink_TrySend------------
+// Send a payload to a 16-bit address if the window has room
+// Input: address  16-bit destination address
+//        data     payload, any byte values
+//        length   payload bytes, 0 to XBEE_PAYLOADMAX
+// Output: 1 if sent, 0 (and nothing sent) if the window is full or
+//         length is too big
+int XBeeLink_TrySend(unsigned short address, const void *data, unsigned short length);
+
+//------------XBeeLink_Send------------
+// Like XBeeLink_TrySend, but waits for room in the window, handling
+// statuses and resends meanwhile
+// Output: 1 if sent, 0 if length is too big
+int XBeeLink_Send(unsigned short address, const void *data, unsigned short length);
+
+//------------XBeeLink_Queue------------
+// Add a message to the pending payload, sending the payload first if the
+// message does not fit or goes to another address.  It never waits, so
+// it may be called from an XBeeLink_Receive handler: when the window
+// has no room for the payload the message is refused, and a full
+// payload stays pending for XBeeLink_Poll to send
+// Input: address  16-bit destination address
+//        message  any byte values
+//        length   message bytes, 0 to XBEELINK_MSGMAX
+// Output: 1 if queued, 0 if length is too big or the window is full
+int XBeeLink_Queue(unsigned short address, const void *message, unsigned char length);
+
+//------------XBeeLink_Flush------------
+// Send the pending payload now, if there is one, waiting for room in
+// the window like XBeeLink_Send (so not from a receive handler)
+// Input: none
+// Output: none
+void XBeeLink_Flush(void);
+
+//------------XBeeLink_Unpack------------
+// Split a payload made by XBeeLink_Queue into its messages
+// Input: payload, its length, handler called once per message in order
+// Output: number of messages, or -1 if the payload is cut short (the
+//         messages before the bad one have been handled)
+int XBeeLink_Unpack(const unsigned char *payload, unsigned short length,
+                    XBeeMessageHandler handler);
+
+//------------XBeeLink_Receive------------
+// Unpack the payload of every RX 16 and RX 64-bit frame (XBeeApi.h) to
+// handler from now on.  The handler runs inside the frame parser, so it
+// may call XBeeLink_TrySend and XBeeLink_Queue but not the waiting
+// XBeeLink_Send or XBeeLink_Flush
+// Input: handler, 0 to stop
+// Output: none
+void XBeeLink_Receive(XBeeMessageHandler handler);
+
+//------------XBeeLink_Poll------------
+// Handle the frames UART1 has received (XBeeApi_Poll), resend frames
+// whose TX status is overdue and send the pending payload when its
+// XBEELINK_COALESCE is up or it is full, call it often
+// Input: none
+// Output: number of frames still in flight
+unsigned short XBeeLink_Poll(void);
+
+//------------XBeeLink_Stats------------
+// Snapshot of the counters, with goodput and round trip times worked out
+// Input: stats points to the structure to fill
+// Output: none
+void XBeeLink_Stats(XBeeLinkStats *stats);
+
+//------------XBeeLink_ResetStats------------
+// Clear the counters and restart the goodput time
+// Input: none
+// Output: none
+void XBeeLink_ResetStats(void);
+
+#endif
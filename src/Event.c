@@ -0,0 +1,42 @@
+// Event.c
+// Runs on LM3S1968
+// Wait/notify between interrupt handlers and foreground code, see Event.h
+// The waiter checks the event and executes WFI with the I bit set.  A
+// pending interrupt still wakes the core from WFI, but its handler only
+// runs once the I bit is cleared again, so there is no window in which
+// a post can slip in after the check but before the sleep.
+
+#include "Event.h"
+#include "SysTick.h"
+
+long StartCritical (void);    // previous I bit, disable interrupts
+void EndCritical(long sr);    // restore I bit to previous value
+void WaitForInterrupt(void);  // low power mode
+
+// called from an interrupt handler (or with interrupts disabled)
+void Event_Post(Event *ev)
+{
+  ev->Posts = ev->Posts+1;
+}
+
+// sleep until ev is posted after the snapshot seen, or ms have passed
+int Event_Wait(Event *ev, unsigned long seen, unsigned long ms)
+{
+  unsigned long start;
+  long sr;
+  start = SysTick_Ms();
+  sr = StartCritical();
+  while(ev->Posts == seen)
+	{
+    if((ms != EVENT_FOREVER) && ((SysTick_Ms()-start) >= ms))
+		{
+      EndCritical(sr);
+      return EVENT_TIMEOUT;
+    }
+    WaitForInterrupt();       // sleep until an interrupt is pending
+    EndCritical(sr);          // let its handler run
+    sr = StartCritical();
+  }
+  EndCritical(sr);
+  return EVENT_POSTED;
+}
@@ -29,11 +29,8 @@
 
 // Two-index implementation of the transmit FIFO
 // can hold 0 to TXFIFOSIZE elements
-#define TXFIFOSIZE 16 // must be a power of 2
-#define TXFIFOSUCCESS 1
-#define TXFIFOFAIL    0
-
-typedef char txDataType;
+// TXFIFOSIZE and txDataType are defined in FIFO.h
+FIFO_STATIC_ASSERT(FIFO_POWER_OF_2(TXFIFOSIZE), TXFIFOSIZE_must_be_a_power_of_2);
 unsigned long volatile TxPutI;// put next
 unsigned long volatile TxGetI;// get next
 txDataType static TxFifo[TXFIFOSIZE];
@@ -72,11 +69,7 @@ unsigned short TxFifo_Size(void){
 
 // Two-pointer implementation of the receive FIFO
 // can hold 0 to RXFIFOSIZE-1 elements
-#define RXFIFOSIZE 10 // can be any size
-#define RXFIFOSUCCESS 1
-#define RXFIFOFAIL    0
-
-typedef char rxDataType;
+// RXFIFOSIZE and rxDataType are defined in FIFO.h
 rxDataType volatile *RxPutPt; // put next
 rxDataType volatile *RxGetPt; // get next
 rxDataType static RxFifo[RXFIFOSIZE];
@@ -120,7 +113,7 @@ int RxFifo_Get(rxDataType *datapt){
 // 0 to RXFIFOSIZE-1
 unsigned short RxFifo_Size(void){
   if(RxPutPt < RxGetPt){
-    return ((unsigned short)(RxPutPt-RxGetPt+(RXFIFOSIZE*sizeof(rxDataType)))/sizeof(rxDataType));
+    return ((unsigned short)(RxPutPt-RxGetPt+RXFIFOSIZE)); // pointer difference counts elements
   }
-  return ((unsigned short)(RxPutPt-RxGetPt)/sizeof(rxDataType));
+  return ((unsigned short)(RxPutPt-RxGetPt));
 }
@@ -0,0 +1,42 @@
+// FIFOArena.c
+// Runs on any LM3Sxxx
+// Fixed static arena that FIFOs created with AddArenaFifo (see FIFO.h)
+// take their storage from when they are initialized.  Sizes can then
+// be chosen per port at init time while the total RAM stays bounded
+// by FIFO_ARENA_SIZE, and running out of room is reported instead of
+// overrunning memory.  Allocations are never freed.
+
+#include "FIFO.h"
+
+#define ARENAWORDS ((FIFO_ARENA_SIZE+sizeof(unsigned long)-1)/sizeof(unsigned long))
+
+unsigned long static Arena[ARENAWORDS]; // word aligned storage
+unsigned long static ArenaUsed;         // words handed out so far
+
+// allocate bytes from the arena
+// returns 0 (and allocates nothing) if the budget would be exceeded
+void *FifoArena_Alloc(unsigned long bytes)
+{
+  unsigned long words;
+  void *pt;
+  long sr;
+  words = (bytes+sizeof(unsigned long)-1)/sizeof(unsigned long);
+  sr = StartCritical();      // make atomic
+  if((words == 0) || (words > ARENAWORDS-ArenaUsed))
+  {
+    pt = 0;                  // Failed, over budget
+  }
+  else
+  {
+    pt = &Arena[ArenaUsed];
+    ArenaUsed = ArenaUsed+words;
+  }
+  EndCritical(sr);
+  return pt;
+}
+
+// total bytes committed to FIFOs so far, 0 to FIFO_ARENA_SIZE
+unsigned long FifoArena_Used(void)
+{
+  return ArenaUsed*sizeof(unsigned long);
+}
@@ -0,0 +1,359 @@
+// FIFOBenchMain.c
+// Runs on LM3S1968
+// Measures the FIFO hot path of the index (AddIndexFifo) and pointer
+// (AddPointerFifo) implementations with the SysTick core-clock counter
+// and prints the results over UART0 as comma separated values, one
+// measurement per line, so runs can be captured and compared later.
+// Each line is
+//   design,type,size,op,burst,count,cycles
+// where cycles is the best of BENCHREPEAT runs of count operations,
+// already corrected for the cost of reading the timer.
+// ops: put, get, size, putblock, getblock (whole FIFO) and
+//      burst, burstblock (ISR-style refill of burst elements, then drain)
+// The uart lines time queueing UARTBENCH bytes for UART0 (which fit in
+// its TX FIFOs, so no waiting is included) one byte at a time with
+// outchar, as a string with outstring, and with write for the same text
+// and for a binary frame full of 0x00 bytes.
+// The fmt lines time one Fmt_UDec, Fmt_UHex and Fmt_Fix (see Format.h)
+// of a number with size characters, the longest each one writes.
+// The xbee lines time streaming a TX request with a full XBEE_PAYLOADMAX
+// payload into the UART1 TX FIFO (XBeeApi_Tx16 and XBeeApi_Tx64), size
+// is the frame bytes on the wire; no radio has to be connected.
+
+// U0Rx (VCP receive) connected to PA0
+// U0Tx (VCP transmit) connected to PA1
+
+#include "FIFO.h"
+#include "UART2.h"
+#include "Format.h"
+#include "XBeeApi.h"
+#include "inc/hw_types.h"
+#include "driverlib/sysctl.h"
+
+#define NVIC_ST_CTRL_R          (*((volatile unsigned long *)0xE000E010))
+#define NVIC_ST_RELOAD_R        (*((volatile unsigned long *)0xE000E014))
+#define NVIC_ST_CURRENT_R       (*((volatile unsigned long *)0xE000E018))
+#define NVIC_ST_CTRL_CLK_SRC    0x00000004  // Clock Source
+#define NVIC_ST_CTRL_ENABLE     0x00000001  // Counter mode
+#define NVIC_ST_RELOAD_M        0x00FFFFFF  // Counter load value
+#define BENCHREPEAT  8          // runs per measurement, best one is kept
+#define BENCHROUNDS  64         // refill/drain rounds per burst measurement
+#define BENCHBURST   16         // largest burst, one hardware FIFO of bytes
+#define UARTBENCH    48         // bytes per UART write, less than UART0_TXFIFOSIZE
+
+typedef struct{
+  char bytes[32];
+} block32;
+
+unsigned long static Overhead;  // cycles spent reading the timer
+
+// cycles since start, SysTick counts down and wraps at 2^24
+unsigned long static elapsed(unsigned long start)
+{
+  return ((start-NVIC_ST_CURRENT_R)&0x00FFFFFF) - Overhead;
+}
+
+// one CSV line
+void static report(char *design, char *type, unsigned short size, char *op,
+                   unsigned short burst, unsigned long count, unsigned long cycles)
+{
+  UART0_OutString(design); UART0_OutChar(',');
+  UART0_OutString(type);   UART0_OutChar(',');
+  UART0_OutUDec(size);     UART0_OutChar(',');
+  UART0_OutString(op);     UART0_OutChar(',');
+  UART0_OutUDec(burst);    UART0_OutChar(',');
+  UART0_OutUDec(count);    UART0_OutChar(',');
+  UART0_OutUDec(cycles);   OutCRLF_UART0();
+}
+
+// macro to create the benchmark for one FIFO created with
+// AddIndexFifo or AddPointerFifo
+// the capacity used is SIZE-1 so both designs move the same count
+#define AddFifoBench(NAME,DESIGN,SIZE,TYPE) \
+void static NAME ## Bench(void){        \
+  static TYPE data;                     \
+  static TYPE blk[BENCHBURST];          \
+  static TYPE all[SIZE];                \
+  unsigned long i, k, r, t, best, b;    \
+  best = 0xFFFFFFFF;                    \
+  for(r=0; r<BENCHREPEAT; r++){         \
+    NAME ## Fifo_Init();                \
+    t = NVIC_ST_CURRENT_R;              \
+    for(i=0; i<SIZE-1; i++){            \
+      NAME ## Fifo_Put(data);           \
+    }                                   \
+    t = elapsed(t);                     \
+    if(t < best) best = t;              \
+  }                                     \
+  report(DESIGN, #TYPE, SIZE, "put", 1, SIZE-1, best); \
+  best = 0xFFFFFFFF;                    \
+  for(r=0; r<BENCHREPEAT; r++){         \
+    NAME ## Fifo_Init();                \
+    for(i=0; i<SIZE-1; i++){            \
+      NAME ## Fifo_Put(data);           \
+    }                                   \
+    t = NVIC_ST_CURRENT_R;              \
+    for(i=0; i<SIZE-1; i++){            \
+      NAME ## Fifo_Get(&data);          \
+    }                                   \
+    t = elapsed(t);                     \
+    if(t < best) best = t;              \
+  }                                     \
+  report(DESIGN, #TYPE, SIZE, "get", 1, SIZE-1, best); \
+  best = 0xFFFFFFFF;                    \
+  for(r=0; r<BENCHREPEAT; r++){         \
+    NAME ## Fifo_Init();                \
+    for(i=0; i<SIZE/2; i++){            \
+      NAME ## Fifo_Put(data);           \
+    }                                   \
+    t = NVIC_ST_CURRENT_R;              \
+    for(i=0; i<SIZE-1; i++){            \
+      NAME ## Fifo_Size();              \
+    }                                   \
+    t = elapsed(t);                     \
+    if(t < best) best = t;              \
+  }                                     \
+  report(DESIGN, #TYPE, SIZE, "size", 1, SIZE-1, best); \
+  best = 0xFFFFFFFF;                    \
+  for(r=0; r<BENCHREPEAT; r++){         \
+    NAME ## Fifo_Init();                \
+    t = NVIC_ST_CURRENT_R;              \
+    NAME ## Fifo_PutBlock(all, SIZE-1); \
+    t = elapsed(t);                     \
+    if(t < best) best = t;              \
+  }                                     \
+  report(DESIGN, #TYPE, SIZE, "putblock", SIZE-1, SIZE-1, best); \
+  best = 0xFFFFFFFF;                    \
+  for(r=0; r<BENCHREPEAT; r++){         \
+    NAME ## Fifo_Init();                \
+    NAME ## Fifo_PutBlock(all, SIZE-1); \
+    t = NVIC_ST_CURRENT_R;              \
+    NAME ## Fifo_GetBlock(all, SIZE-1); \
+    t = elapsed(t);                     \
+    if(t < best) best = t;              \
+  }                                     \
+  report(DESIGN, #TYPE, SIZE, "getblock", SIZE-1, SIZE-1, best); \
+  for(b=1; (b<=BENCHBURST) && (b<SIZE); b++){ \
+    best = 0xFFFFFFFF;                  \
+    for(r=0; r<BENCHREPEAT; r++){       \
+      NAME ## Fifo_Init();              \
+      t = NVIC_ST_CURRENT_R;            \
+      for(i=0; i<BENCHROUNDS; i++){     \
+        for(k=0; k<b; k++){             \
+          NAME ## Fifo_Put(data);       \
+        }                               \
+        for(k=0; k<b; k++){             \
+          NAME ## Fifo_Get(&data);      \
+        }                               \
+      }                                 \
+      t = elapsed(t);                   \
+      if(t < best) best = t;            \
+    }                                   \
+    report(DESIGN, #TYPE, SIZE, "burst", b, BENCHROUNDS*b, best); \
+    best = 0xFFFFFFFF;                  \
+    for(r=0; r<BENCHREPEAT; r++){       \
+      NAME ## Fifo_Init();              \
+      t = NVIC_ST_CURRENT_R;            \
+      for(i=0; i<BENCHROUNDS; i++){     \
+        NAME ## Fifo_PutBlock(blk, b);  \
+        NAME ## Fifo_GetBlock(blk, b);  \
+      }                                 \
+      t = elapsed(t);                   \
+      if(t < best) best = t;            \
+    }                                   \
+    report(DESIGN, #TYPE, SIZE, "burstblock", b, BENCHROUNDS*b, best); \
+  }                                     \
+}
+
+// sizes are limited by the 64 kbyte RAM of the LM3S1968
+AddIndexFifo(IdxC8, 8, char, 1, 0)
+AddIndexFifo(IdxC64, 64, char, 1, 0)
+AddIndexFifo(IdxC512, 512, char, 1, 0)
+AddIndexFifo(IdxC4096, 4096, char, 1, 0)
+AddIndexFifo(IdxS8, 8, unsigned short, 1, 0)
+AddIndexFifo(IdxS64, 64, unsigned short, 1, 0)
+AddIndexFifo(IdxS512, 512, unsigned short, 1, 0)
+AddIndexFifo(IdxB8, 8, block32, 1, 0)
+AddIndexFifo(IdxB64, 64, block32, 1, 0)
+AddPointerFifo(PtrC8, 8, char, 1, 0)
+AddPointerFifo(PtrC64, 64, char, 1, 0)
+AddPointerFifo(PtrC512, 512, char, 1, 0)
+AddPointerFifo(PtrC4096, 4096, char, 1, 0)
+AddPointerFifo(PtrS8, 8, unsigned short, 1, 0)
+AddPointerFifo(PtrS64, 64, unsigned short, 1, 0)
+AddPointerFifo(PtrS512, 512, unsigned short, 1, 0)
+AddPointerFifo(PtrB8, 8, block32, 1, 0)
+AddPointerFifo(PtrB64, 64, block32, 1, 0)
+
+AddFifoBench(IdxC8, "index", 8, char)
+AddFifoBench(IdxC64, "index", 64, char)
+AddFifoBench(IdxC512, "index", 512, char)
+AddFifoBench(IdxC4096, "index", 4096, char)
+AddFifoBench(IdxS8, "index", 8, unsigned short)
+AddFifoBench(IdxS64, "index", 64, unsigned short)
+AddFifoBench(IdxS512, "index", 512, unsigned short)
+AddFifoBench(IdxB8, "index", 8, block32)
+AddFifoBench(IdxB64, "index", 64, block32)
+AddFifoBench(PtrC8, "pointer", 8, char)
+AddFifoBench(PtrC64, "pointer", 64, char)
+AddFifoBench(PtrC512, "pointer", 512, char)
+AddFifoBench(PtrC4096, "pointer", 4096, char)
+AddFifoBench(PtrS8, "pointer", 8, unsigned short)
+AddFifoBench(PtrS64, "pointer", 64, unsigned short)
+AddFifoBench(PtrS512, "pointer", 512, unsigned short)
+AddFifoBench(PtrB8, "pointer", 8, block32)
+AddFifoBench(PtrB64, "pointer", 64, block32)
+
+// time one way of queueing UARTBENCH bytes for UART0
+// op 0 is OutChar per byte, 1 is OutString, 2 is Write
+unsigned long static uartTime(int op, char *buf)
+{
+  unsigned long i, r, t, best;
+  best = 0xFFFFFFFF;
+  for(r=0; r<BENCHREPEAT; r++){
+    UART0_TxFlush();         // start with the software FIFO empty
+    t = NVIC_ST_CURRENT_R;
+    if(op == 0){
+      for(i=0; i<UARTBENCH; i++){
+        UART0_OutChar(buf[i]);
+      }
+    } else if(op == 1){
+      UART0_OutString(buf);
+    } else{
+      UART0_Write(buf, UARTBENCH);
+    }
+    t = elapsed(t);
+    UART0_TxFlush();         // let the timed bytes go before the report
+    if(t < best) best = t;
+  }
+  return best;
+}
+
+void static UartBench(void)
+{
+  static char text[UARTBENCH+1];
+  static char frame[UARTBENCH];  // all 0x00, needs the binary-safe Write
+  unsigned long i, t;
+  for(i=0; i<UARTBENCH; i++){
+    text[i] = 'a'+(i%26);
+  }
+  text[UARTBENCH] = 0;
+  t = uartTime(0, text);
+  report("uart", "text", UARTBENCH, "outchar", UARTBENCH, UARTBENCH, t);
+  t = uartTime(1, text);
+  report("uart", "text", UARTBENCH, "outstring", UARTBENCH, UARTBENCH, t);
+  t = uartTime(2, text);
+  report("uart", "text", UARTBENCH, "write", UARTBENCH, UARTBENCH, t);
+  t = uartTime(0, frame);
+  report("uart", "binary", UARTBENCH, "outchar", UARTBENCH, UARTBENCH, t);
+  t = uartTime(2, frame);
+  report("uart", "binary", UARTBENCH, "write", UARTBENCH, UARTBENCH, t);
+}
+
+void static FormatBench(void)
+{
+  char buf[FMT_DECMAX+2];
+  unsigned long r, t, best;
+  best = 0xFFFFFFFF;
+  for(r=0; r<BENCHREPEAT; r++){
+    t = NVIC_ST_CURRENT_R;
+    Fmt_UDec(buf, 4294967295UL);
+    t = elapsed(t);
+    if(t < best) best = t;
+  }
+  report("fmt", "long", 10, "udec", 1, 1, best);
+  best = 0xFFFFFFFF;
+  for(r=0; r<BENCHREPEAT; r++){
+    t = NVIC_ST_CURRENT_R;
+    Fmt_UHex(buf, 0xFFFFFFFF);
+    t = elapsed(t);
+    if(t < best) best = t;
+  }
+  report("fmt", "long", 8, "uhex", 1, 1, best);
+  best = 0xFFFFFFFF;
+  for(r=0; r<BENCHREPEAT; r++){
+    t = NVIC_ST_CURRENT_R;
+    Fmt_Fix(buf, -2147483647, 3);
+    t = elapsed(t);
+    if(t < best) best = t;
+  }
+  report("fmt", "long", 12, "fix", 1, 1, best);
+}
+
+// time one full-payload TX request, 16 or 64-bit address
+unsigned long static xbeeTime(int wide, unsigned char *payload)
+{
+  static const unsigned char address[8] = {0,0,0,0,0,0,0,0x4F};
+  unsigned long r, t, best;
+  best = 0xFFFFFFFF;
+  for(r=0; r<BENCHREPEAT; r++){
+    UART1_TxFlush();         // start with the software FIFO empty
+    t = NVIC_ST_CURRENT_R;
+    if(wide){
+      XBeeApi_Tx64(0, address, XBEE_TXOPT_NOACK, payload, XBEE_PAYLOADMAX);
+    } else{
+      XBeeApi_Tx16(0, 0x004F, XBEE_TXOPT_NOACK, payload, XBEE_PAYLOADMAX);
+    }
+    t = elapsed(t);
+    if(t < best) best = t;
+  }
+  UART1_TxFlush();
+  return best;
+}
+
+void static XBeeBench(void)
+{
+  static unsigned char payload[XBEE_PAYLOADMAX];
+  unsigned long i, t;
+  for(i=0; i<XBEE_PAYLOADMAX; i++){
+    payload[i] = i;          // includes 0x00 and other binary values
+  }
+  t = xbeeTime(0, payload);
+  report("xbee", "tx16", XBEE_PAYLOADMAX+9, "stream", 1, 1, t);
+  t = xbeeTime(1, payload);
+  report("xbee", "tx64", XBEE_PAYLOADMAX+15, "stream", 1, 1, t);
+}
+
+int main(void)
+{
+  unsigned long t;
+  // Set the clocking to run at 50MHz from the PLL.
+  SysCtlClockSet(SYSCTL_SYSDIV_4 | SYSCTL_USE_PLL | SYSCTL_OSC_MAIN |
+                 SYSCTL_XTAL_8MHZ);
+                             // free-running 24-bit SysTick, no interrupts
+  NVIC_ST_CTRL_R = 0;
+  NVIC_ST_RELOAD_R = NVIC_ST_RELOAD_M;
+  NVIC_ST_CURRENT_R = 0;
+  NVIC_ST_CTRL_R = NVIC_ST_CTRL_ENABLE+NVIC_ST_CTRL_CLK_SRC;
+  UART0_Init();              // initialize UART0
+  UART1_Init();              // XBee port, for the xbee lines
+  EnableInterrupts();
+  Overhead = 0;
+  t = NVIC_ST_CURRENT_R;
+  Overhead = elapsed(t);     // cost of one timer read
+  OutCRLF_UART0();
+  UART0_OutString("design,type,size,op,burst,count,cycles"); OutCRLF_UART0();
+  IdxC8Bench();
+  IdxC64Bench();
+  IdxC512Bench();
+  IdxC4096Bench();
+  IdxS8Bench();
+  IdxS64Bench();
+  IdxS512Bench();
+  IdxB8Bench();
+  IdxB64Bench();
+  PtrC8Bench();
+  PtrC64Bench();
+  PtrC512Bench();
+  PtrC4096Bench();
+  PtrS8Bench();
+  PtrS64Bench();
+  PtrS512Bench();
+  PtrB8Bench();
+  PtrB64Bench();
+  UartBench();
+  FormatBench();
+  XBeeBench();
+  UART0_OutString("done"); OutCRLF_UART0();
+  while(1){};
+}
@@ -0,0 +1,141 @@
+// Format.c
+// Runs on any LM3Sxxx
+// Number to ASCII conversion into a caller supplied buffer, see Format.h
+// n/100 is computed as (n*0x51EB851F)>>37, which the compiler turns
+// into one UMULL and a shift, and is exact for every 32-bit n.  Each
+// quotient yields two digits from the Pairs table, so a 10-digit
+// number takes five multiplies instead of ten divides and ten calls.
+
+#include "Format.h"
+
+#define DIV100(N) ((unsigned long)(((unsigned long long)(N)*0x51EB851FUL)>>37))
+#define UDECDIGITS 10  // digits in the largest 32-bit number
+
+char const static Pairs[200] =
+  "0001020304050607080910111213141516171819"
+  "2021222324252627282930313233343536373839"
+  "4041424344454647484950515253545556575859"
+  "6061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+char const static HexDigits[16] = "0123456789ABCDEF";
+
+// write the decimal digits of n so they end just before end
+// returns a pointer to the first digit
+char static *udecDigits(char *end, unsigned long n)
+{
+  unsigned long q, r;
+  while(n >= 100)
+  {
+    q = DIV100(n);
+    r = 2*(n-q*100);          // index of the last two digits in Pairs
+    end = end-2;
+    end[0] = Pairs[r];
+    end[1] = Pairs[r+1];
+    n = q;
+  }
+  if(n >= 10)
+  {
+    end = end-2;
+    end[0] = Pairs[2*n];
+    end[1] = Pairs[2*n+1];
+  }
+  else
+  {
+    end = end-1;
+    end[0] = '0'+n;
+  }
+  return end;
+}
+
+// copy len characters from src to buf followed by a NULL
+// returns len
+unsigned short static copyOut(char *buf, const char *src, unsigned short len)
+{
+  unsigned short i;
+  for(i=0; i<len; i++)
+  {
+    buf[i] = src[i];
+  }
+  buf[len] = 0;
+  return len;
+}
+
+unsigned short Fmt_UDec(char *buf, unsigned long n)
+{
+  char digits[UDECDIGITS];
+  char *first;
+  first = udecDigits(&digits[UDECDIGITS], n);
+  return copyOut(buf, first, &digits[UDECDIGITS]-first);
+}
+
+unsigned short Fmt_Dec(char *buf, long n)
+{
+  if(n < 0)
+  {
+    buf[0] = '-';             // 0-n is also right for the most negative n
+    return 1+Fmt_UDec(&buf[1], 0-(unsigned long)n);
+  }
+  return Fmt_UDec(buf, n);
+}
+
+unsigned short Fmt_UHex(char *buf, unsigned long n)
+{
+  unsigned short len, i;
+  len = 1;
+  while((len < 8) && (n>>(4*len)))
+  {
+    len++;
+  }
+  for(i=len; i>0; i--)
+  {
+    buf[i-1] = HexDigits[n&0x0F];
+    n = n>>4;
+  }
+  buf[len] = 0;
+  return len;
+}
+
+unsigned short Fmt_UDecWidth(char *buf, unsigned long n, unsigned short width)
+{
+  char digits[UDECDIGITS];
+  char *first;
+  unsigned short len, pad, i;
+  first = udecDigits(&digits[UDECDIGITS], n);
+  len = &digits[UDECDIGITS]-first;
+  pad = (width > len) ? width-len : 0;
+  for(i=0; i<pad; i++)
+  {
+    buf[i] = '0';
+  }
+  return pad+copyOut(&buf[pad], first, len);
+}
+
+unsigned short Fmt_Fix(char *buf, long n, unsigned short decimals)
+{
+  unsigned long u;
+  unsigned short len, i;
+  char *pt;
+  pt = buf;
+  u = n;
+  if(n < 0)
+  {
+    *pt++ = '-';
+    u = 0-u;                  // also right for the most negative n
+  }
+  if(decimals > UDECDIGITS)
+  {
+    decimals = UDECDIGITS;
+  }
+  len = Fmt_UDecWidth(pt, u, decimals+1); // at least one digit before '.'
+  if(decimals)
+  {
+    for(i=len; i>len-decimals; i--)
+    {
+      pt[i] = pt[i-1];        // open a gap for the '.'
+    }
+    pt[len+1] = 0;
+    pt[len-decimals] = '.';
+    len = len+1;
+  }
+  return (pt-buf)+len;
+}
@@ -0,0 +1,135 @@
+// Parse.c
+// Runs on any LM3Sxxx
+// ASCII to number conversion of a whole line already in memory, see
+// Parse.h.  Overflow is found before the multiply that would wrap, by
+// comparing with the largest value that can still take another digit,
+// so no divide and no 64-bit arithmetic are needed.
+
+#include "Parse.h"
+
+#define UDECLIMIT 429496729   // (2^32-1)/10, any more and another digit wraps
+#define UDECLAST  5           // largest last digit on top of UDECLIMIT
+
+// number of spaces and tabs at the start of pt
+unsigned short static blanks(const char *pt)
+{
+  unsigned short n = 0;
+  while((pt[n] == ' ') || (pt[n] == '\t'))
+  {
+    n++;
+  }
+  return n;
+}
+
+// value of hex digit c, or 0x10 if c is not one
+unsigned long static hexDigit(char c)
+{
+  if((c>='0') && (c<='9'))
+  {
+    return c-'0';
+  }
+  if((c>='A') && (c<='F'))
+  {
+    return (c-'A')+0xA;
+  }
+  if((c>='a') && (c<='f'))
+  {
+    return (c-'a')+0xA;
+  }
+  return 0x10;
+}
+
+// digits of an unsigned decimal starting at pt, no blanks or sign
+// returns the characters consumed
+unsigned short static udecDigits(const char *pt, unsigned long *value, int *status)
+{
+  unsigned long number = 0, digit;
+  unsigned short n = 0;
+  *status = PARSE_NONE;
+  while((pt[n]>='0') && (pt[n]<='9'))
+  {
+    digit = pt[n]-'0';
+    if(*status != PARSE_OVERFLOW)
+    {
+      if((number > UDECLIMIT) || ((number == UDECLIMIT) && (digit > UDECLAST)))
+      {
+        *status = PARSE_OVERFLOW;
+        number = 0xFFFFFFFF;
+      }
+      else
+      {
+        *status = PARSE_OK;
+        number = 10*number+digit;
+      }
+    }
+    n++;
+  }
+  *value = number;
+  return n;
+}
+
+unsigned short Parse_UDec(const char *pt, unsigned long *value, int *status)
+{
+  unsigned short n;
+  n = blanks(pt);
+  return n+udecDigits(&pt[n], value, status);
+}
+
+unsigned short Parse_Dec(const char *pt, long *value, int *status)
+{
+  unsigned long magnitude, limit;
+  unsigned short n, digits;
+  int negative = 0;
+  n = blanks(pt);
+  if((pt[n] == '-') || (pt[n] == '+'))
+  {
+    negative = (pt[n] == '-');
+    digits = udecDigits(&pt[n+1], &magnitude, status);
+    if(digits == 0)
+    {
+      *value = 0;
+      return n;             // a sign on its own is not consumed
+    }
+    n = n+1+digits;
+  }
+  else
+  {
+    n = n+udecDigits(&pt[n], &magnitude, status);
+  }
+  limit = negative ? 0x80000000 : 0x7FFFFFFF;
+  if((*status == PARSE_OVERFLOW) || (magnitude > limit))
+  {
+    *status = PARSE_OVERFLOW;
+    magnitude = limit;
+  }
+  *value = negative ? (long)(0-magnitude) : (long)magnitude;
+  return n;
+}
+
+unsigned short Parse_UHex(const char *pt, unsigned long *value, int *status)
+{
+  unsigned long number = 0, digit;
+  unsigned short n;
+  n = blanks(pt);
+  if((pt[n] == '0') && ((pt[n+1] == 'x') || (pt[n+1] == 'X')) && (hexDigit(pt[n+2]) <= 0xF))
+  {
+    n = n+2;                // "0x" only counts as a prefix when digits follow
+  }
+  *status = PARSE_NONE;
+  while((digit = hexDigit(pt[n])) <= 0xF)
+  {
+    if(number > 0x0FFFFFFF)
+    {
+      *status = PARSE_OVERFLOW;  // a ninth significant digit
+      number = 0xFFFFFFFF;
+    }
+    else if(*status != PARSE_OVERFLOW)
+    {
+      *status = PARSE_OK;
+      number = 0x10*number+digit;
+    }
+    n++;
+  }
+  *value = number;
+  return n;
+}
@@ -37,24 +37,51 @@
 #define NVIC_ST_CTRL_INTEN      0x00000002  // Interrupt enable
 #define NVIC_ST_CTRL_ENABLE     0x00000001  // Counter mode
 #define NVIC_ST_RELOAD_M        0x00FFFFFF  // Counter load value
+#define SYSTICK_PERIOD          50000       // 1 ms at 50 MHz
 
-// Initialize SysTick with busy wait running at bus clock.
+unsigned long static volatile Ms;       // SysTick interrupts since SysTick_Init
+
+// Initialize SysTick to interrupt every 1 ms running at bus clock.
+// SysTick_Ms() only advances once interrupts are enabled, the busy
+// waits work either way.
 void SysTick_Init(void)
 {
   NVIC_ST_CTRL_R = 0;                   // disable SysTick during setup
-  NVIC_ST_RELOAD_R = NVIC_ST_RELOAD_M;  // maximum reload value
+  NVIC_ST_RELOAD_R = SYSTICK_PERIOD-1;  // reload value for 1 ms
   NVIC_ST_CURRENT_R = 0;                // any write to current clears it
-                                        // enable SysTick with core clock
-  NVIC_ST_CTRL_R = NVIC_ST_CTRL_ENABLE+NVIC_ST_CTRL_CLK_SRC;
+  Ms = 0;
+                                        // enable SysTick with core clock and interrupts
+  NVIC_ST_CTRL_R = NVIC_ST_CTRL_ENABLE+NVIC_ST_CTRL_CLK_SRC+NVIC_ST_CTRL_INTEN;
+}
+// Executed every 1 ms
+void SysTick_Handler(void)
+{
+  Ms = Ms+1;
+}
+// Milliseconds since SysTick_Init, wraps after about 49 days
+// Compare times by subtraction, (SysTick_Ms()-start) >= timeout
+unsigned long SysTick_Ms(void)
+{
+  return Ms;
 }
 // Time delay using busy wait.
 // The delay parameter is in units of the core clock. (units of 20 nsec for 50 MHz clock)
+// The counter wraps every SYSTICK_PERIOD cycles, so it must be polled
+// more often than that (an interrupt handler must not hold it off for 1 ms)
 void SysTick_Wait(unsigned long delay)
 {
-  volatile unsigned long elapsedTime;
-  unsigned long startTime = NVIC_ST_CURRENT_R;
+  unsigned long elapsedTime = 0;
+  unsigned long lastTime = NVIC_ST_CURRENT_R;
+  unsigned long nowTime;
   do{
-    elapsedTime = (startTime-NVIC_ST_CURRENT_R)&0x00FFFFFF;
+    nowTime = NVIC_ST_CURRENT_R;
+    if(nowTime <= lastTime){
+      elapsedTime += lastTime-nowTime;
+    }
+    else{                               // counter reloaded
+      elapsedTime += lastTime+SYSTICK_PERIOD-nowTime;
+    }
+    lastTime = nowTime;
   }
   while(elapsedTime <= delay);
 }
@@ -26,36 +26,58 @@
  http://users.ece.utexas.edu/~valvano/
  */
 
-// U0Rx (VCP receive) connected to PA0
-// U0Tx (VCP transmit) connected to PA1
+// One driver serves all three UARTs.  Everything that differs between
+// them (register block, pins, interrupt, baud rate, software FIFOs)
+// is in the Ports table, so another serial link is one more entry.
+// U0Rx (VCP receive) connected to PA0, U0Tx (VCP transmit) to PA1
+// U1Rx (XBee DOUT) connected to PD2,   U1Tx (XBee DIN) to PD3
+// U2Rx connected to PG0,               U2Tx connected to PG1
 
 #include "FIFO.h"
+#include "Event.h"
+#include "Format.h"
+#include "Parse.h"
+#include "SysTick.h"
 #include "UART2.h"
 #include "lm3s1968.h"
 
-#define NVIC_EN0_INT5           0x00000020  // Interrupt 5 enable
-#define NVIC_EN0_R              (*((volatile unsigned long *)0xE000E100))  // IRQ 0 to 31 Set Enable Register
-#define NVIC_PRI1_R             (*((volatile unsigned long *)0xE000E404))  // IRQ 4 to 7 Priority Register
-#define GPIO_PORTA_AFSEL_R      (*((volatile unsigned long *)0x40004420))
-#define GPIO_PORTA_DEN_R        (*((volatile unsigned long *)0x4000451C))
-#define UART0_DR_R              (*((volatile unsigned long *)0x4000C000))
-#define UART0_FR_R              (*((volatile unsigned long *)0x4000C018))
-#define UART0_IBRD_R            (*((volatile unsigned long *)0x4000C024))
-#define UART0_FBRD_R            (*((volatile unsigned long *)0x4000C028))
-#define UART0_LCRH_R            (*((volatile unsigned long *)0x4000C02C))
-#define UART0_CTL_R             (*((volatile unsigned long *)0x4000C030))
-#define UART0_IFLS_R            (*((volatile unsigned long *)0x4000C034))
-#define UART0_IM_R              (*((volatile unsigned long *)0x4000C038))
-#define UART0_RIS_R             (*((volatile unsigned long *)0x4000C03C))
-#define UART0_ICR_R             (*((volatile unsigned long *)0x4000C044))
+// register offsets within a UART block
+#define UART_DR                 0x000
+#define UART_RSR                0x004       // read: receive status, write: clear it (ECR)
+#define UART_FR                 0x018
+#define UART_IBRD               0x024
+#define UART_FBRD               0x028
+#define UART_LCRH               0x02C
+#define UART_CTL                0x030
+#define UART_IFLS               0x034
+#define UART_IM                 0x038
+#define UART_RIS                0x03C
+#define UART_ICR                0x044
+#define UART_REG(PORT,OFFSET)   (*((volatile unsigned long *)((PORT)->Base+(OFFSET))))
+// register offsets within a GPIO port
+#define GPIO_DIR                0x400
+#define GPIO_IS                 0x404
+#define GPIO_IBE                0x408
+#define GPIO_IM                 0x410
+#define GPIO_ICR                0x41C
+#define GPIO_AFSEL              0x420
+#define GPIO_DEN                0x51C
+#define GPIO_REG(PORT,OFFSET)   (*((volatile unsigned long *)((PORT)->GpioBase+(OFFSET))))
+// NVIC set enable register and priority byte of interrupt IRQ
+#define NVIC_EN_R(IRQ)          (*((volatile unsigned long *)(0xE000E100+4*((IRQ)>>5))))
+#define NVIC_PRI_R(IRQ)         (*((volatile unsigned char *)(0xE000E400+(IRQ))))
+#define UART_RSR_OE             0x00000008  // UART Overrun Error
 #define UART_FR_RXFF            0x00000040  // UART Receive FIFO Full
 #define UART_FR_TXFF            0x00000020  // UART Transmit FIFO Full
 #define UART_FR_RXFE            0x00000010  // UART Receive FIFO Empty
+#define UART_FR_BUSY            0x00000008  // UART Busy
 #define UART_LCRH_WLEN_8        0x00000060  // 8 bit word length
 #define UART_LCRH_FEN           0x00000010  // UART Enable FIFOs
 #define UART_CTL_UARTEN         0x00000001  // UART Enable
 #define UART_IFLS_RX1_8         0x00000000  // RX FIFO >= 1/8 full
 #define UART_IFLS_TX1_8         0x00000000  // TX FIFO <= 1/8 full
+#define UART_IFLS_RX_M          0x00000038  // RX FIFO level field
+#define UART_IFLS_RX_S          3           // 1/8, 1/4, 1/2, 3/4, 7/8 full are 0 to 4
 #define UART_IM_RTIM            0x00000040  // UART Receive Time-Out Interrupt
                                             // Mask
 #define UART_IM_TXIM            0x00000020  // UART Transmit Interrupt Mask
@@ -69,274 +91,814 @@
 #define UART_ICR_RTIC           0x00000040  // Receive Time-Out Interrupt Clear
 #define UART_ICR_TXIC           0x00000020  // Transmit Interrupt Clear
 #define UART_ICR_RXIC           0x00000010  // Receive Interrupt Clear
+#define DWT_CTRL_R              (*((volatile unsigned long *)0xE0001000))
+#define DWT_CYCCNT_R            (*((volatile unsigned long *)0xE0001004))
+#define DEMCR_R                 (*((volatile unsigned long *)0xE000EDFC))
+#define DWT_CTRL_CYCCNTENA      0x00000001  // cycle counter enable
+#define DEMCR_TRCENA            0x01000000  // DWT and ITM enable
 #define SYSCTL_RCGC1_R          (*((volatile unsigned long *)0x400FE104))
 #define SYSCTL_RCGC2_R          (*((volatile unsigned long *)0x400FE108))
 #define SYSCTL_RCGC1_UART0      0x00000001  // UART0 Clock Gating Control
 #define SYSCTL_RCGC2_GPIOA      0x00000001  // port A Clock Gating Control
+#define UART_CLOCK              50000000    // bus clock set by the PLL, Hz
+#define UART_NUMBERLINE         24          // line buffer of InUDec/InUHex, blanks and digits
+#define UART_PRIORITY           2           // NVIC priority of every UART
 
 void DisableInterrupts(void); // Disable interrupts
 void EnableInterrupts(void);  // Enable interrupts
 long StartCritical (void);    // previous I bit, disable interrupts
 void EndCritical(long sr);    // restore I bit to previous value
-void WaitForInterrupt(void);  // low power mode
-#define FIFOSIZE   16         // size of the FIFOs (must be power of 2)
 #define FIFOSUCCESS 1         // return value on success
 #define FIFOFAIL    0         // return value on failure
-                              // create index implementation FIFO (see FIFO.h)
-AddIndexFifo(Rx, FIFOSIZE, char, FIFOSUCCESS, FIFOFAIL)
-AddIndexFifo(Tx, FIFOSIZE, char, FIFOSUCCESS, FIFOFAIL)
+#define SPANMAX 0xFFFF        // ask Reserve/Peek for as much as they have
+#ifdef UART1_CTS
+// register of the GPIO port with the XBee CTS pin, and the pin level
+#define CTS_REG(OFFSET)         (*((volatile unsigned long *)(UART1_CTS_GPIO+(OFFSET))))
+#define CTS_HIGH()              CTS_REG(UART1_CTS_PIN<<2)  // nonzero while the XBee is full
+#endif
+
+// one entry per UART, kept in ROM
+typedef struct UartPort UartPort;
+struct UartPort{
+  unsigned long Base;         // UART register block
+  unsigned long GpioBase;     // GPIO port with the RX and TX pins
+  unsigned long Pins;         // RX and TX pins in that port
+  unsigned long RcgcUart;     // SYSCTL_RCGC1_R bit of the UART
+  unsigned long RcgcGpio;     // SYSCTL_RCGC2_R bit of the GPIO port
+  unsigned long Irq;          // NVIC interrupt number
+  unsigned long Baud;         // bits/sec
+  unsigned short RxSize;      // default software FIFO sizes, used by UART_Init
+  unsigned short TxSize;
+  const CharFifoOps *Rx;      // software RX FIFO
+  const CharFifoOps *Tx;      // software TX FIFO
+  int (*Open)(void);          // port specific setup run first by UART_InitSizes, or 0
+  int (*TxFill)(const UartPort *port); // software to hardware TX FIFO copy,
+                                       // returns nonzero while bytes are still queued
+  const CharFifoOps *Lines;   // completed lines in line mode, LinePool indices
+};
+
+                              // create index implementation FIFOs sized at
+                              // init time from the FIFO arena (see FIFO.h)
+AddArenaFifo(ConsoleRx, char, FIFOSUCCESS, FIFOFAIL)
+AddArenaFifo(ConsoleTx, char, FIFOSUCCESS, FIFOFAIL)
+AddCharFifoOps(ConsoleRx)
+AddCharFifoOps(ConsoleTx)
+AddArenaFifo(XBeeRx, char, FIFOSUCCESS, FIFOFAIL)
+AddArenaFifo(XBeeTx, char, FIFOSUCCESS, FIFOFAIL)   // bulk data
+AddArenaFifo(XBeeTxHi, char, FIFOSUCCESS, FIFOFAIL) // control frames, sent first
+AddCharFifoOps(XBeeRx)
+AddCharFifoOps(XBeeTx)
+AddArenaFifo(AuxRx, char, FIFOSUCCESS, FIFOFAIL)
+AddArenaFifo(AuxTx, char, FIFOSUCCESS, FIFOFAIL)
+AddCharFifoOps(AuxRx)
+AddCharFifoOps(AuxTx)
+AddArenaFifo(ConsoleLine, char, FIFOSUCCESS, FIFOFAIL) // taken when line mode
+AddArenaFifo(XBeeLine, char, FIFOSUCCESS, FIFOFAIL)    // is first turned on
+AddArenaFifo(AuxLine, char, FIFOSUCCESS, FIFOFAIL)
+AddCharFifoOps(ConsoleLine)
+AddCharFifoOps(XBeeLine)
+AddCharFifoOps(AuxLine)
+
+unsigned long static Baud[UART_PORTS]; // actual rate set by UART_InitSizes or UART_SetBaud
+Event static RxData[UART_PORTS];  // posted by the handler after filling the RX FIFO
+Event static TxSpace[UART_PORTS]; // posted by the handler after draining the TX FIFO
+
+// line mode, the handler edits input straight into buffers from a pool
+// shared by all ports and queues the index of each finished line
+#define NOLINE 0xFF           // LineState.Cur when no buffer is being filled
+char static LinePool[UART_LINES][UART_LINESIZE];
+AddIndexFifo(LineFree, UART_LINES, unsigned char, FIFOSUCCESS, FIFOFAIL)
+int static LinePoolReady;     // true once LineFree holds the whole pool
+typedef struct{
+  unsigned char Mode;         // UART_LINE_OFF, or UART_LINE_ON plus UART_LINE_ECHO
+  unsigned char Cur;          // LinePool index being filled, or NOLINE
+  unsigned short Len;         // characters in it so far
+  char Last;                  // previous character, CR LF ends only one line
+  unsigned long Lost;         // characters dropped with no free buffer
+} LineState;
+LineState static Line[UART_PORTS];
+
+// interrupt counts and the adaptive RX FIFO level, only the handler
+// writes them once the UART is running
+typedef struct{
+  UartIrqRate Now;            // counts in the second that started at Start
+  UartIrqRate Last;           // counts of the previous whole second
+  unsigned long Start;        // SysTick_Ms at the start of Now
+  unsigned char RxLevel;      // UART_IFLS RX level, 0 (1/8) to UART_RXLEVELMAX
+  unsigned char RxRun;        // RX level interrupts since the last time-out
+} IrqState;
+IrqState static Irq[UART_PORTS];
+#ifdef FIFO_STATS
+unsigned long static Overruns[UART_PORTS]; // bytes lost, hardware RX FIFO was full
+#endif
+unsigned char const static RxLevelEighths[5] = {1, 2, 4, 6, 7};
+
+#ifdef UART_PROFILE
+// handler timing with the DWT cycle counter, see UART2.h
+UartProfile static Profile[UART_PORTS];
+unsigned long static RxPostedAt[UART_PORTS]; // cycle count of the first unread RX post
+unsigned char static RxPending[UART_PORTS];  // RxPostedAt is valid
+// count cycles in the histogram bin of its power of 2
+void static profileAdd(unsigned long *hist, unsigned long cycles)
+{
+  unsigned char bin = 0;
+  while((cycles >>= 1) && (bin < UART_HISTBINS-1))
+	{
+    bin++;
+  }
+  hist[bin]++;
+}
+// handler posted RX data, start timing how long it waits to be read
+void static profileRxPosted(unsigned char port)
+{
+  if(!RxPending[port])
+	{
+    RxPostedAt[port] = DWT_CYCCNT_R;
+    RxPending[port] = 1;
+  }
+}
+// foreground read RX data, it waited since the first unread post
+void static profileRxRead(unsigned char port)
+{
+  unsigned long wait;
+  long sr;
+  sr = StartCritical();
+  if(RxPending[port])
+	{
+    wait = DWT_CYCCNT_R-RxPostedAt[port];
+    if(wait > Profile[port].MaxRxWait)
+		{
+      Profile[port].MaxRxWait = wait;
+    }
+    RxPending[port] = 0;
+  }
+  EndCritical(sr);
+}
+#define PROFILE_STAMP(T)        (T) = DWT_CYCCNT_R
+#define PROFILE_ADD(HIST,T)     profileAdd(HIST, DWT_CYCCNT_R-(T))
+#define PROFILE_RXPOSTED(PORT)  profileRxPosted(PORT)
+#define PROFILE_RXREAD(PORT)    profileRxRead(PORT)
+#else
+#define PROFILE_STAMP(T)
+#define PROFILE_ADD(HIST,T)
+#define PROFILE_RXPOSTED(PORT)
+#define PROFILE_RXREAD(PORT)
+#endif
+
+int static copySoftwareToHardware(const UartPort *port);
+int static openXBee(void);
+int static copySoftwareToHardware_XBee(const UartPort *port);
+void static copyHardwareToLine(unsigned char port);
+
+UartPort const static Ports[UART_PORTS] = {
+  {0x4000C000, 0x40004000, 0x03, SYSCTL_RCGC1_UART0, SYSCTL_RCGC2_GPIOA, 5,
+   UART0_BAUD, UART0_RXFIFOSIZE, UART0_TXFIFOSIZE,
+   &ConsoleRxFifo_Ops, &ConsoleTxFifo_Ops, 0, copySoftwareToHardware,
+   &ConsoleLineFifo_Ops},
+  {0x4000D000, 0x40007000, 0x0C, SYSCTL_RCGC1_UART1, SYSCTL_RCGC2_GPIOD, 6,
+   UART1_BAUD, UART1_RXFIFOSIZE, UART1_TXFIFOSIZE,
+   &XBeeRxFifo_Ops, &XBeeTxFifo_Ops, openXBee, copySoftwareToHardware_XBee,
+   &XBeeLineFifo_Ops},
+  {0x4000E000, 0x40026000, 0x03, SYSCTL_RCGC1_UART2, SYSCTL_RCGC2_GPIOG, 33,
+   UART2_BAUD, UART2_RXFIFOSIZE, UART2_TXFIFOSIZE,
+   &AuxRxFifo_Ops, &AuxTxFifo_Ops, 0, copySoftwareToHardware,
+   &AuxLineFifo_Ops}
+};
 
 /////////////////////////////////////////////////////////
-//---------------------OUTCRLF_UART0---------------------
-// Output a CR,LF to UART0 to go to a new line
-// Input: none
+//---------------------UART_OutCRLF---------------------
+// Output a CR,LF to the UART to go to a new line
+// Input: port number
 // Output: none
-void OutCRLF_UART0(void)
+void UART_OutCRLF(unsigned char port)
 {
-  UART0_OutChar(CR);
-  UART0_OutChar(LF);
+  UART_Write(port, "\r\n", 2);
 }
 /////////////////////////////////////////////////////////
 
-// Initialize UART0
-// Baud rate is 115200 bits/sec - I changed this to 9600 bits/sec
-void UART0_Init(void)
-{
-  SYSCTL_RCGC1_R |= SYSCTL_RCGC1_UART0; // activate UART0
-  SYSCTL_RCGC2_R |= SYSCTL_RCGC2_GPIOA; // activate port A
-  RxFifo_Init();                        // initialize empty FIFOs
-  TxFifo_Init();
-  UART0_CTL_R &= ~UART_CTL_UARTEN;      // disable UART
-  UART0_IBRD_R = 325;///27;                    // IBRD = int(50,000,000 / (16 * 115,200)) = int(27.1267)
-  UART0_FBRD_R =  33;///8;                     // FBRD = int(0.1267 * 64 + 0.5) = 8
+// Initialize the UART with the default software FIFO sizes
+int UART_Init(unsigned char port)
+{
+  return UART_InitSizes(port, Ports[port].RxSize, Ports[port].TxSize);
+}
+
+// baud rate divisor in 1/64ths, 64*clock/(16*baud) rounded
+// IBRD is divider>>6 and FBRD is divider&0x3F, e.g. 50 MHz and 9600 bits/sec
+// give 20833 so IBRD = 325 and FBRD = 33 (325.52 = 50,000,000/(16*9600))
+// returns 0 if the rate cannot be made from clock (IBRD must be 1 to 65535)
+unsigned long static baudDivider(unsigned long clock, unsigned long baud)
+{
+  unsigned long divider;
+  if((baud == 0) || (clock/16 < baud))
+	{
+    return 0;
+  }
+  divider = (4*clock+baud/2)/baud;
+  if((divider>>6) > 0xFFFF)
+	{
+    return 0;
+  }
+  return divider;
+}
+
+// Initialize the UART at the baud rate in its Ports entry
+// (all three run at 9600 bits/sec by default, see UART2.h)
+// Software FIFOs of rxSize and txSize bytes come from the FIFO arena
+int UART_InitSizes(unsigned char port, unsigned short rxSize, unsigned short txSize)
+{
+  const UartPort *p = &Ports[port];
+  unsigned long divider;
+  divider = baudDivider(UART_CLOCK, p->Baud);
+  if(divider == 0)
+	{
+    return(FIFOFAIL);                   // Baud cannot be made from UART_CLOCK
+  }
+  if((p->Open && (p->Open() == FIFOFAIL)) ||
+     (p->Rx->Init(rxSize) == FIFOFAIL) || (p->Tx->Init(txSize) == FIFOFAIL))
+	{
+    return(FIFOFAIL);                   // bad size or arena out of room
+  }
+  SYSCTL_RCGC1_R |= p->RcgcUart;        // activate UART
+  SYSCTL_RCGC2_R |= p->RcgcGpio;        // activate GPIO port
+  UART_REG(p, UART_CTL) &= ~UART_CTL_UARTEN; // disable UART
+  UART_REG(p, UART_IBRD) = divider>>6;
+  UART_REG(p, UART_FBRD) = divider&0x3F;
+  Baud[port] = (4*UART_CLOCK+divider/2)/divider;
                                         // 8 bit word length (no parity bits, one stop bit, FIFOs)
-  UART0_LCRH_R = (UART_LCRH_WLEN_8|UART_LCRH_FEN);
-  UART0_IFLS_R &= ~0x3F;                // clear TX and RX interrupt FIFO level fields
+  UART_REG(p, UART_LCRH) = (UART_LCRH_WLEN_8|UART_LCRH_FEN);
+  UART_REG(p, UART_IFLS) &= ~0x3F;      // clear TX and RX interrupt FIFO level fields
                                         // configure interrupt for TX FIFO <= 1/8 full
                                         // configure interrupt for RX FIFO >= 1/8 full
-  UART0_IFLS_R += (UART_IFLS_TX1_8|UART_IFLS_RX1_8);
+  UART_REG(p, UART_IFLS) += (UART_IFLS_TX1_8|UART_IFLS_RX1_8);
+  Irq[port].RxLevel = Irq[port].RxRun = 0;
+  Irq[port].Start = SysTick_Ms();
+  Irq[port].Now.Irqs = Irq[port].Now.Tx = Irq[port].Now.Rx = Irq[port].Now.Rt = 0;
+  Irq[port].Last = Irq[port].Now;
+#ifdef UART_PROFILE
+  DEMCR_R |= DEMCR_TRCENA;              // start the cycle counter
+  DWT_CTRL_R |= DWT_CTRL_CYCCNTENA;
+  UART_ResetProfile(port);
+#endif
                                         // enable TX and RX FIFO interrupts and RX time-out interrupt
-  UART0_IM_R |= (UART_IM_RXIM|UART_IM_TXIM|UART_IM_RTIM);
-  UART0_CTL_R |= UART_CTL_UARTEN;       // enable UART
-  GPIO_PORTA_AFSEL_R |= 0x03;           // enable alt funct on PA1-0
-  GPIO_PORTA_DEN_R |= 0x03;             // enable digital I/O on PA1-0
-                                        // UART0=priority 2
-  NVIC_PRI1_R = (NVIC_PRI1_R&0xFFFF00FF)|0x00004000; // bits 13-15
-  NVIC_EN0_R |= NVIC_EN0_INT5;          // enable interrupt 5 in NVIC
+  UART_REG(p, UART_IM) |= (UART_IM_RXIM|UART_IM_TXIM|UART_IM_RTIM);
+  UART_REG(p, UART_CTL) |= UART_CTL_UARTEN; // enable UART
+  GPIO_REG(p, GPIO_AFSEL) |= p->Pins;   // enable alt funct on the RX and TX pins
+  GPIO_REG(p, GPIO_DEN) |= p->Pins;     // enable digital I/O on the RX and TX pins
+                                        // priority in bits 7-5 of the byte
+  NVIC_PRI_R(p->Irq) = UART_PRIORITY<<5;
+  NVIC_EN_R(p->Irq) = 1<<(p->Irq&31);   // enable interrupt in NVIC
+  return(FIFOSUCCESS);
 }
 // copy from hardware RX FIFO to software RX FIFO
 // stop when hardware RX FIFO is empty or software RX FIFO is full
-void static copyHardwareToSoftware_UART0(void)
+void static copyHardwareToSoftware(const UartPort *p)
 {
-  char letter;
-  while(((UART0_FR_R&UART_FR_RXFE) == 0) && (RxFifo_Size() < (FIFOSIZE - 1)))
+  char *pt;
+  unsigned short n, i;
+  do
 	{
-    letter = UART0_DR_R;
-    RxFifo_Put(letter);
+    n = SPANMAX;
+    pt = p->Rx->Reserve(&n);            // read straight into the ring
+    for(i=0; (i < n) && ((UART_REG(p, UART_FR)&UART_FR_RXFE) == 0); i++)
+		{
+      pt[i] = UART_REG(p, UART_DR);
+    }
+    p->Rx->Commit(i);
   }
+  while(n && (i == n));                 // span ended at the wrap point
 }
 // copy from software TX FIFO to hardware TX FIFO
 // stop when software TX FIFO is empty or hardware TX FIFO is full
-void static copySoftwareToHardware_UART0(void)
+// returns nonzero if bytes are left in the software TX FIFO
+int static copySoftwareToHardware(const UartPort *p)
 {
-  char letter;
-  while(((UART0_FR_R&UART_FR_TXFF) == 0) && (TxFifo_Size() > 0))
+  char *pt;
+  unsigned short n, i;
+  do
+	{
+    n = SPANMAX;
+    pt = p->Tx->Peek(&n);               // send straight from the ring
+    for(i=0; (i < n) && ((UART_REG(p, UART_FR)&UART_FR_TXFF) == 0); i++)
+		{
+      UART_REG(p, UART_DR) = pt[i];
+    }
+    p->Tx->Consume(i);
+  }
+  while(n && (i == n));                 // span ended at the wrap point
+  return p->Tx->Size();
+}
+// keep every interrupt that runs p->TxFill away while the foreground
+// runs it: the TX interrupt, and for UART1 with flow control the CTS edge
+void static txMask(const UartPort *p)
+{
+  UART_REG(p, UART_IM) &= ~UART_IM_TXIM; // disable TX FIFO interrupt
+#ifdef UART1_CTS
+  if(p == &Ports[UART_PORT1])
+	{
+    CTS_REG(GPIO_IM) &= ~UART1_CTS_PIN;
+  }
+#endif
+}
+void static txUnmask(const UartPort *p)
+{
+  UART_REG(p, UART_IM) |= UART_IM_TXIM;  // enable TX FIFO interrupt
+#ifdef UART1_CTS
+  if(p == &Ports[UART_PORT1])
 	{
-    TxFifo_Get(&letter);
-    UART0_DR_R = letter;
+    CTS_REG(GPIO_IM) |= UART1_CTS_PIN;   // an edge while masked is still pending
   }
+#endif
+}
+// copy whatever is queued to the hardware TX FIFO with the TX interrupt
+// masked, so the handler cannot run the copy at the same time
+// returns nonzero if bytes are still queued in software
+int static startTx(const UartPort *p)
+{
+  int queued;
+  txMask(p);
+  queued = p->TxFill(p);
+  txUnmask(p);
+  return queued;
+}
+// sleep until the handler posts RX data after seen, or until ms have
+// passed since start (UART_FOREVER never ends)
+// returns EVENT_TIMEOUT once the time is used up, the caller checks its
+// FIFO again after every EVENT_POSTED
+int static rxWait(unsigned char port, unsigned long seen, unsigned long start, unsigned long ms)
+{
+  unsigned long spent;
+  if(ms == UART_FOREVER)
+	{
+    return Event_Wait(&RxData[port], seen, EVENT_FOREVER);
+  }
+  spent = SysTick_Ms()-start;
+  if(spent >= ms)
+	{
+    return EVENT_TIMEOUT;
+  }
+  Event_Wait(&RxData[port], seen, ms-spent);
+  return EVENT_POSTED;                  // a time-out here is seen on the next call
 }
 // input ASCII character from UART
-// spin if RxFifo is empty
-unsigned char UART0_InChar(void)
+// sleep until the handler posts if RxFifo is empty
+unsigned char UART_InChar(unsigned char port)
 {
   char letter;
-  while(RxFifo_Get(&letter) == FIFOFAIL){};
+  UART_InCharTimeout(port, &letter, UART_FOREVER);
   return(letter);
 }
 // output ASCII character to UART
-// spin if TxFifo is full
-void UART0_OutChar(unsigned char data)
+// sleep until the handler posts if TxFifo is full
+void UART_OutChar(unsigned char port, unsigned char data)
+{
+  unsigned long seen;
+  seen = Event_Seen(&TxSpace[port]);
+  while(Ports[port].Tx->Put(data) == FIFOFAIL)
+	{
+    Event_Wait(&TxSpace[port], seen, EVENT_FOREVER);
+    seen = Event_Seen(&TxSpace[port]);
+  }
+  startTx(&Ports[port]);
+}
+// move the RX interrupt to a new hardware FIFO level
+void static setRxLevel(const UartPort *p, IrqState *st, unsigned char level)
 {
-  while(TxFifo_Put(data) == FIFOFAIL){};
-  UART0_IM_R &= ~UART_IM_TXIM;          // disable TX FIFO interrupt
-  copySoftwareToHardware_UART0();
-  UART0_IM_R |= UART_IM_TXIM;           // enable TX FIFO interrupt
+  st->RxLevel = level;
+  UART_REG(p, UART_IFLS) = (UART_REG(p, UART_IFLS)&~UART_IFLS_RX_M)|(level<<UART_IFLS_RX_S);
 }
 // at least one of three things has happened:
 // hardware TX FIFO goes from 3 to 2 or less items
-// hardware RX FIFO goes from 1 to 2 or more items
+// hardware RX FIFO reaches the RX level (2 items unless adapted)
 // UART receiver has timed out
-void UART0_Handler(void)
+// While data streams in, every RX level interrupt is followed by another
+// without a time-out in between, so after UART_RXADAPT of them the RX
+// level goes up a step (up to UART_RXLEVELMAX), moving more bytes per
+// interrupt.  Once the stream pauses the time-out picks up the tail
+// bytes and the level drops back to 1/8 so typed input is seen at once.
+// The TX level stays at 1/8, the lowest, so each TX interrupt already
+// refills the hardware FIFO with 14 bytes.
+void static uartHandler(unsigned char port)
 {
-  if(UART0_RIS_R&UART_RIS_TXRIS)
+  const UartPort *p = &Ports[port];
+  IrqState *st = &Irq[port];
+  unsigned long now;
+#ifdef UART_PROFILE
+  unsigned long tHandler, tSource, cycles;
+#endif
+  PROFILE_STAMP(tHandler);
+  now = SysTick_Ms();
+  if((now-st->Start) >= 1000)
+	{
+    st->Last = st->Now;
+    if((now-st->Start) >= 2000)
+		{                                   // no interrupt at all last second
+      st->Last.Irqs = st->Last.Tx = st->Last.Rx = st->Last.Rt = 0;
+    }
+    st->Now.Irqs = st->Now.Tx = st->Now.Rx = st->Now.Rt = 0;
+    st->Start = now;
+  }
+  st->Now.Irqs++;
+#ifdef FIFO_STATS
+  if(UART_REG(p, UART_RSR)&UART_RSR_OE)
+	{       // a byte arrived to a full hardware RX FIFO and was lost
+    Overruns[port]++;
+    UART_REG(p, UART_RSR) = 0;          // clear the error
+  }
+#endif
+  if(UART_REG(p, UART_RIS)&UART_RIS_TXRIS)
 	{       // hardware TX FIFO <= 2 items
-    UART0_ICR_R = UART_ICR_TXIC;        // acknowledge TX FIFO
+    PROFILE_STAMP(tSource);
+    st->Now.Tx++;
+    UART_REG(p, UART_ICR) = UART_ICR_TXIC; // acknowledge TX FIFO
     // copy from software TX FIFO to hardware TX FIFO
-    copySoftwareToHardware_UART0();
-    if(TxFifo_Size() == 0)
+    if(p->TxFill(p) == 0)
 		{             // software TX FIFO is empty
-      UART0_IM_R &= ~UART_IM_TXIM;      // disable TX FIFO interrupt
+      UART_REG(p, UART_IM) &= ~UART_IM_TXIM; // disable TX FIFO interrupt
     }
+    Event_Post(&TxSpace[port]);
+    PROFILE_ADD(Profile[port].Tx, tSource);
   }
-  if(UART0_RIS_R&UART_RIS_RXRIS)
-	{       // hardware RX FIFO >= 2 items
-    UART0_ICR_R = UART_ICR_RXIC;        // acknowledge RX FIFO
-    // copy from hardware RX FIFO to software RX FIFO
-    copyHardwareToSoftware_UART0();
+  if(UART_REG(p, UART_RIS)&UART_RIS_RXRIS)
+	{       // hardware RX FIFO at the RX level
+    PROFILE_STAMP(tSource);
+    st->Now.Rx++;
+    st->RxRun++;
+    if((st->RxRun >= UART_RXADAPT) && (st->RxLevel < UART_RXLEVELMAX))
+		{     // continuous input
+      setRxLevel(p, st, st->RxLevel+1);
+      st->RxRun = 0;
+    }
+    UART_REG(p, UART_ICR) = UART_ICR_RXIC; // acknowledge RX FIFO
+    // copy from hardware RX FIFO to software RX FIFO (or line buffer)
+    if(Line[port].Mode)
+		{
+      copyHardwareToLine(port);
+    }
+    else
+		{
+      copyHardwareToSoftware(p);
+    }
+    Event_Post(&RxData[port]);
+    PROFILE_RXPOSTED(port);
+    PROFILE_ADD(Profile[port].Rx, tSource);
   }
-  if(UART0_RIS_R&UART_RIS_RTRIS)
+  if(UART_REG(p, UART_RIS)&UART_RIS_RTRIS)
 	{       // receiver timed out
-    UART0_ICR_R = UART_ICR_RTIC;        // acknowledge receiver time out
-    // copy from hardware RX FIFO to software RX FIFO
-    copyHardwareToSoftware_UART0();
+    PROFILE_STAMP(tSource);
+    st->Now.Rt++;
+    st->RxRun = 0;
+    if(st->RxLevel)
+		{                                   // input paused, back to interactive
+      setRxLevel(p, st, 0);
+    }
+    UART_REG(p, UART_ICR) = UART_ICR_RTIC; // acknowledge receiver time out
+    // copy from hardware RX FIFO to software RX FIFO (or line buffer)
+    if(Line[port].Mode)
+		{
+      copyHardwareToLine(port);
+    }
+    else
+		{
+      copyHardwareToSoftware(p);
+    }
+    Event_Post(&RxData[port]);
+    PROFILE_RXPOSTED(port);
+    PROFILE_ADD(Profile[port].Rt, tSource);
+  }
+#ifdef UART_PROFILE
+  cycles = DWT_CYCCNT_R-tHandler;
+  profileAdd(Profile[port].Handler, cycles);
+  if(cycles > Profile[port].MaxHandler)
+	{
+    Profile[port].MaxHandler = cycles;
+  }
+#endif
+}
+void UART0_Handler(void)
+{
+  uartHandler(UART_PORT0);
+}
+void UART1_Handler(void)
+{
+  uartHandler(UART_PORT1);
+}
+void UART2_Handler(void)
+{
+  uartHandler(UART_PORT2);
+}
+
+
+//------------UART_TxReserve------------
+// Reserve contiguous space in the software TX FIFO so a producer
+//   can build its output in place
+// Input: port number, n points to the number of bytes wanted
+// Output: pointer to the writable span, *n lowered to the bytes granted
+char *UART_TxReserve(unsigned char port, unsigned short *n)
+{
+  return Ports[port].Tx->Reserve(n);
+}
+
+//------------UART_TxReserveWait------------
+// Like UART_TxReserve, but sleeps until the handler posts while the
+//   software TX FIFO is full, so at least one byte is granted
+// Input: port number, n points to the number of bytes wanted (not 0)
+// Output: pointer to the writable span, *n lowered to the bytes granted
+char *UART_TxReserveWait(unsigned char port, unsigned short *n)
+{
+  unsigned short want = *n;
+  unsigned long seen;
+  char *pt;
+  seen = Event_Seen(&TxSpace[port]);
+  pt = Ports[port].Tx->Reserve(n);
+  while(*n == 0)
+	{
+    Event_Wait(&TxSpace[port], seen, EVENT_FOREVER);
+    seen = Event_Seen(&TxSpace[port]);
+    *n = want;
+    pt = Ports[port].Tx->Reserve(n);
   }
+  return pt;
 }
 
+//------------UART_TxCommit------------
+// Queue n bytes written into a UART_TxReserve span and start sending
+// Input: port number, number of bytes written
+// Output: none
+void UART_TxCommit(unsigned char port, unsigned short n)
+{
+  Ports[port].Tx->Commit(n);
+  startTx(&Ports[port]);
+}
 
-//------------UART0_OutString------------
-// Output String (NULL termination)
-// Input: pointer to a NULL-terminated string to be transferred
+//------------UART_OutCharLossy------------
+// Output 8-bit to serial port without ever waiting, for telemetry
+// If the software TX FIFO is full the oldest unsent byte is dropped
+// Input: port number, letter is an 8-bit ASCII character to be transferred
+// Output: none
+void UART_OutCharLossy(unsigned char port, unsigned char data)
+{
+  Ports[port].Tx->PutOverwrite(data);
+  startTx(&Ports[port]);
+}
+
+//------------UART_OutStringLossy------------
+// Output String (NULL termination) without ever waiting, for telemetry
+// If the software TX FIFO fills the oldest unsent bytes are dropped
+// Input: port number, pointer to a NULL-terminated string to be transferred
 // Output: none
-void UART0_OutString(char *pt)
+void UART_OutStringLossy(unsigned char port, char *pt)
 {
   while(*pt)
 	{
-    UART0_OutChar(*pt);
+    Ports[port].Tx->PutOverwrite(*pt);
     pt++;
   }
+  startTx(&Ports[port]);
 }
 
-//------------UART0_InUDec------------
-// InUDec accepts ASCII input in unsigned decimal format
-//     and converts to a 32-bit unsigned number
-//     valid range is 0 to 4294967295 (2^32-1)
-// Input: none
-// Output: 32-bit unsigned number
-// If you enter a number above 4294967295, it will return an incorrect value
-// Backspace will remove last digit typed
-unsigned long UART0_InUDec(void)
+//------------UART_TxDropped------------
+// Number of bytes dropped by the lossy outputs since the UART was initialized
+// Input: port number
+// Output: count of overwritten bytes
+unsigned long UART_TxDropped(unsigned char port)
 {
-	unsigned long number=0, length=0;
-	char character;
-  character = UART0_InChar();
-  while(character != CR)
-	{ // accepts until <enter> is typed
-// The next line checks that the input is a digit, 0-9.
-// If the character is not 0-9, it is ignored and not echoed
-    if((character>='0') && (character<='9')) 
+  return Ports[port].Tx->Dropped();
+}
+
+//------------UART_TryWrite------------
+// Queue as many of the len bytes as fit right now, without waiting
+// The TX interrupt is masked once for the whole call while the
+// software and hardware TX FIFOs are filled in blocks
+// Input: port number, pointer to the bytes (any values, 0 included), count
+// Output: number of bytes accepted, 0 to len
+unsigned long UART_TryWrite(unsigned char port, const void *buf, unsigned long len)
+{
+  const UartPort *p = &Ports[port];
+  const char *pt = buf;
+  unsigned long done = 0;
+  unsigned short n;
+  txMask(p);
+  do
+	{
+    n = (len-done > SPANMAX) ? SPANMAX : (unsigned short)(len-done);
+    n = p->Tx->PutBlock(pt+done, n);    // 0 if software TX FIFO is full
+    done = done+n;
+    p->TxFill(p);                       // hardware TX FIFO takes some, making room
+  }
+  while(n && (done < len));
+  txUnmask(p);
+  return done;
+}
+
+//------------UART_Write------------
+// Output len bytes, sleeping while the software TX FIFO is full
+// The TX interrupt is masked and unmasked once per FIFO full of data
+// Input: port number, pointer to the bytes (any values, 0 included), count
+// Output: none
+void UART_Write(unsigned char port, const void *buf, unsigned long len)
+{
+  const char *pt = buf;
+  unsigned long n, seen;
+  while(len)
+	{
+    seen = Event_Seen(&TxSpace[port]);
+    n = UART_TryWrite(port, pt, len);
+    pt = pt+n;
+    len = len-n;
+    if(len)
 		{
-      number = 10*number+(character-'0');   // this line overflows if above 4294967295
-      length++;
-      UART0_OutChar(character);
+      Event_Wait(&TxSpace[port], seen, EVENT_FOREVER); // sleep until the handler drains some
     }
-// If the input is a backspace, then the return number is
-// changed and a backspace is outputted to the screen
-    else if((character==BS) && length)
+  }
+}
+
+//------------UART_TxFlush------------
+// Wait until everything queued for the UART has gone to the hardware
+// Input: port number
+// Output: none
+void UART_TxFlush(unsigned char port)
+{
+  unsigned long seen;
+  seen = Event_Seen(&TxSpace[port]);
+  while(startTx(&Ports[port]))
+	{
+    Event_Wait(&TxSpace[port], seen, EVENT_FOREVER);
+    seen = Event_Seen(&TxSpace[port]);
+  }
+}
+
+//------------UART_OutString------------
+// Output String (NULL termination)
+// Input: port number, pointer to a NULL-terminated string to be transferred
+// Output: none
+void UART_OutString(unsigned char port, char *pt)
+{
+  unsigned long n;
+  for(n=0; pt[n]; n++){}
+  UART_Write(port, pt, n);
+}
+
+//------------UART_SetBaud------------
+// Change the baud rate of an initialized UART, see UART2.h
+// Input: port number, bus clock in Hz, baud rate in bits/sec
+// Output: rate error in 0.01% units, or UART_BAUDBAD
+long UART_SetBaud(unsigned char port, unsigned long clock, unsigned long baud)
+{
+  const UartPort *p = &Ports[port];
+  unsigned long divider, actual;
+  divider = baudDivider(clock, baud);
+  if(divider == 0)
+	{
+    return UART_BAUDBAD;
+  }
+  actual = (4*clock+divider/2)/divider;
+  UART_TxFlush(port);                   // queued bytes go out at the old rate
+  while(UART_REG(p, UART_FR)&UART_FR_BUSY){} // including the one being shifted
+  UART_REG(p, UART_CTL) &= ~UART_CTL_UARTEN; // disable UART
+  UART_REG(p, UART_IBRD) = divider>>6;
+  UART_REG(p, UART_FBRD) = divider&0x3F;
+  UART_REG(p, UART_LCRH) = UART_REG(p, UART_LCRH); // new divisors take effect on an LCRH write
+  UART_REG(p, UART_CTL) |= UART_CTL_UARTEN;  // enable UART
+  Baud[port] = actual;
+  return (long)((((long long)actual-(long long)baud)*10000)/(long long)baud);
+}
+
+//------------UART_Baud------------
+// Actual baud rate, which differs from the one asked for by the error
+// Input: port number
+// Output: bits/sec
+unsigned long UART_Baud(unsigned char port)
+{
+  return Baud[port];
+}
+
+//------------UART_IrqRate------------
+// Interrupts taken by the UART in the last whole second, see UART2.h
+// Input: port number, rate points to the structure to fill
+// Output: RX interrupt level now, in eighths of the hardware FIFO
+unsigned char UART_IrqRate(unsigned char port, UartIrqRate *rate)
+{
+  IrqState *st = &Irq[port];
+  long sr;
+  sr = StartCritical();
+  *rate = st->Last;
+  if((SysTick_Ms()-st->Start) >= 2000)
+	{                                     // quiet for more than a second
+    rate->Irqs = rate->Tx = rate->Rx = rate->Rt = 0;
+  }
+  EndCritical(sr);
+  return RxLevelEighths[st->RxLevel];
+}
+
+// one line holding a number for UART_InUDec/UART_InUHex, parsed whole
+// afterwards by Parse.h; in line mode it comes from the line queue
+// (edited and echoed by the handler), else it is read here with echo
+// and backspace by UART_InString
+void static inNumberLine(unsigned char port, char *line)
+{
+  char *pt;
+  unsigned short i;
+  if(Line[port].Mode)
+	{
+    pt = UART_InLine(port);
+    for(i=0; (i < UART_NUMBERLINE-1) && pt[i]; i++)
 		{
-      number /= 10;
-      length--;
-      UART0_OutChar(character);
+      line[i] = pt[i];
     }
-    character = UART0_InChar();
+    line[i] = 0;
+    UART_LineRelease(pt);
   }
+  else
+	{
+    UART_InString(port, line, UART_NUMBERLINE-1);
+  }
+}
+
+//------------UART_InUDec------------
+// InUDec accepts ASCII input in unsigned decimal format
+//     and converts to a 32-bit unsigned number
+//     valid range is 0 to 4294967295 (2^32-1)
+// Input: port number
+// Output: 32-bit unsigned number
+// The whole line is read first (from UART_InLine in line mode) and
+// converted by Parse_UDec; a number above 4294967295 returns 4294967295
+// Backspace will remove last digit typed
+unsigned long UART_InUDec(unsigned char port)
+{
+  unsigned long number;
+  UART_InUDecStatus(port, &number);
   return number;
 }
 
-//-----------------------UART0_OutUDec-----------------------
+//------------UART_InUDecStatus------------
+// Like UART_InUDec, but reports a bad or out of range number
+// Input: port number, where to store the number
+// Output: PARSE_OK, PARSE_NONE (no digits, *number is 0) or
+//         PARSE_OVERFLOW (*number is 4294967295), see Parse.h
+int UART_InUDecStatus(unsigned char port, unsigned long *number)
+{
+  char line[UART_NUMBERLINE];
+  int status;
+  inNumberLine(port, line);
+  Parse_UDec(line, number, &status);
+  return status;
+}
+
+//-----------------------UART_OutUDec-----------------------
 // Output a 32-bit number in unsigned decimal format
-// Input: 32-bit number to be transferred
+// Input: port number, 32-bit number to be transferred
 // Output: none
 // Variable format 1-10 digits with no space before or after
-void UART0_OutUDec(unsigned long n)
+void UART_OutUDec(unsigned char port, unsigned long n)
 {
-// This function uses recursion to convert decimal number
-//   of unspecified length as an ASCII string
-  if(n >= 10)
-	{
-    UART0_OutUDec(n/10);
-    n = n%10;
-  }
-  UART0_OutChar(n+'0'); /* n is between 0 and 9 */
+  char buf[FMT_UDECMAX];
+  UART_Write(port, buf, Fmt_UDec(buf, n)); // all digits in one write
 }
 
-//---------------------UART0_InUHex----------------------------------------
+//---------------------UART_InUHex----------------------------------------
 // Accepts ASCII input in unsigned hexadecimal (base 16) format
-// Input: none
+// Input: port number
 // Output: 32-bit unsigned number
 // No '$' or '0x' need be entered, just the 1 to 8 hex digits
 // It will convert lower case a-f to uppercase A-F
 //     and converts to a 16 bit unsigned number
 //     value range is 0 to FFFFFFFF
-// If you enter a number above FFFFFFFF, it will return an incorrect value
+// The whole line is read first (from UART_InLine in line mode) and
+// converted by Parse_UHex; a number above FFFFFFFF returns FFFFFFFF
 // Backspace will remove last digit typed
-unsigned long UART0_InUHex(void)
+unsigned long UART_InUHex(unsigned char port)
 {
-	unsigned long number=0, digit, length=0;
-	char character;
-  character = UART0_InChar();
-  while(character != CR)
-	{
-    digit = 0x10; // assume bad
-    if((character>='0') && (character<='9'))
-		{
-      digit = character-'0';
-    }
-    else if((character>='A') && (character<='F'))
-		{
-      digit = (character-'A')+0xA;
-    }
-    else if((character>='a') && (character<='f'))
-		{
-      digit = (character-'a')+0xA;
-    }
-// If the character is not 0-9 or A-F, it is ignored and not echoed
-    if(digit <= 0xF)
-		{
-      number = number*0x10+digit;
-      length++;
-      UART0_OutChar(character);
-    }
-// Backspace outputted and return value changed if a backspace is inputted
-    else if((character==BS) && length)
-		{
-      number /= 0x10;
-      length--;
-      UART0_OutChar(character);
-    }
-    character = UART0_InChar();
-  }
+  unsigned long number;
+  UART_InUHexStatus(port, &number);
   return number;
 }
 
-//--------------------------UART0_OutUHex----------------------------
+//------------UART_InUHexStatus------------
+// Like UART_InUHex, but reports a bad or out of range number
+// Input: port number, where to store the number
+// Output: PARSE_OK, PARSE_NONE (no digits, *number is 0) or
+//         PARSE_OVERFLOW (*number is FFFFFFFF), see Parse.h
+int UART_InUHexStatus(unsigned char port, unsigned long *number)
+{
+  char line[UART_NUMBERLINE];
+  int status;
+  inNumberLine(port, line);
+  Parse_UHex(line, number, &status);
+  return status;
+}
+
+//--------------------------UART_OutUHex----------------------------
 // Output a 32-bit number in unsigned hexadecimal format
-// Input: 32-bit number to be transferred
+// Input: port number, 32-bit number to be transferred
 // Output: none
 // Variable format 1 to 8 digits with no space before or after
-void UART0_OutUHex(unsigned long number)
+void UART_OutUHex(unsigned char port, unsigned long number)
 {
-// This function uses recursion to convert the number of
-//   unspecified length as an ASCII string
-  if(number >= 0x10)
-	{
-    UART0_OutUHex(number/0x10);
-    UART0_OutUHex(number%0x10);
-  }
-  else
-	{
-    if(number < 0xA)
-		{
-      UART0_OutChar(number+'0');
-    }
-    else
-		{
-      UART0_OutChar((number-0x0A)+'A');
-    }
-  }
+  char buf[FMT_UHEXMAX];
+  UART_Write(port, buf, Fmt_UHex(buf, number)); // all digits in one write
 }
 
-//------------UART0_InString------------
+//------------UART_InString------------
 // Accepts ASCII characters from the serial port
 //    and adds them to a string until <enter> is typed
 //    or until max length of the string is reached.
@@ -345,14 +907,14 @@ void UART0_OutUHex(unsigned long number)
 //    and the backspace is echoed
 // terminates the string with a null character
 // uses busy-waiting synchronization on RDRF
-// Input: pointer to empty buffer, size of buffer
+// Input: port number, pointer to empty buffer, size of buffer
 // Output: Null terminated string
 // -- Modified by Agustinus Darmawan + Mingjie Qiu --
-void UART0_InString(char *bufPt, unsigned short max) 
+void UART_InString(unsigned char port, char *bufPt, unsigned short max)
 {
 	int length=0;
 	char character;
-  character = UART0_InChar();
+  character = UART_InChar(port);
   while(character != CR)
 	{
     if(character == BS)
@@ -361,7 +923,7 @@ void UART0_InString(char *bufPt, unsigned short max)
 			{
         bufPt--;
         length--;
-        UART0_OutChar(BS);
+        UART_OutChar(port, BS);
       }
     }
     else if(length < max)
@@ -369,322 +931,666 @@ void UART0_InString(char *bufPt, unsigned short max)
       *bufPt = character;
       bufPt++;
       length++;
-      UART0_OutChar(character);
+      UART_OutChar(port, character);
     }
-    character = UART0_InChar();
+    character = UART_InChar(port);
   }
   *bufPt = 0;
 }
 
-
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Make UART1 for going to the XBEE///////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////
-////////////////
-AddIndexFifo(XBeeRx, FIFOSIZE, char, FIFOSUCCESS, FIFOFAIL)
-AddIndexFifo(XBeeTx, FIFOSIZE, char, FIFOSUCCESS, FIFOFAIL)
-
-//---------------------OUTCRLF_UART1---------------------
-// Output a CR,LF to UART1 to go to a new line
-// Input: none
-// Output: none
-void OutCRLF_UART1(void)
+//------------UART_TryInChar------------
+// Input one character if there is one, without waiting
+// Input: port number, where to store the character
+// Output: UART_OK, or UART_TIMEOUT if the RX FIFO is empty
+int UART_TryInChar(unsigned char port, char *data)
 {
-  UART1_OutChar(CR);
-  UART1_OutChar(LF);
-}
-////////////////
-void UART1_Init(void)
-{
-  SYSCTL_RCGC1_R |= SYSCTL_RCGC1_UART1; // activate UART1
-  SYSCTL_RCGC2_R |= SYSCTL_RCGC2_GPIOD; // activate port D
-
-  XBeeRxFifo_Init();                    // initialize empty FIFOs
-  XBeeTxFifo_Init();
-	
-  UART1_CTL_R &= ~UART_CTL_UARTEN;      // disable UART
-	//what i think it is
-	UART1_IBRD_R = 325; // IBRD = int(50,000,000 / (16 * 9600)) = int(325.52)
-	UART1_FBRD_R = 33;  // FBRD = int(0.5208 * 64 + 0.5) = 33.83333
-	
- // need to see how to change this to be 9600 bits/s, currently 115,200 bits/s
-//	UART1_IBRD_R = 27;                    // IBRD = int(50,000,000 / (16 * 115,200)) = int(27.1267)
-//  UART1_FBRD_R = 8;                     // FBRD = int(0.1267 * 64 + 0.5) = 8
-                                        // 8 bit word length (no parity bits, one stop bit, FIFOs)
-  UART1_LCRH_R = (UART_LCRH_WLEN_8|UART_LCRH_FEN);
-  UART1_IFLS_R &= ~0x3F;                // clear TX and RX interrupt FIFO level fields
-                                        // configure interrupt for TX FIFO <= 1/8 full
-                                        // configure interrupt for RX FIFO >= 1/8 full
-  UART1_IFLS_R += (UART_IFLS_TX1_8|UART_IFLS_RX1_8);
-                                        // enable TX and RX FIFO interrupts and RX time-out interrupt
-  UART1_IM_R |= (UART_IM_RXIM|UART_IM_TXIM|UART_IM_RTIM);
-  UART1_CTL_R |= UART_CTL_UARTEN;       // enable UART
-	
-	
-	GPIO_PORTD_AFSEL_R |= 0x0C; // enable alt funct on PD3-2         
-  GPIO_PORTD_DEN_R |= 0x0C;             // enable digital I/O on PD3-2
-                                        // UART1=priority 2
-											
-	// this should set UART1 to interrupt	in the NVIC																		
-  NVIC_PRI1_R = (NVIC_PRI1_R&0xFF1FFFFF)|0x00004000; // bits 21-23
-  NVIC_EN0_R |= NVIC_EN0_INT6;          // enable interrupt 5 in NVIC
+  if(Ports[port].Rx->Get(data) == FIFOFAIL)
+	{
+    return UART_TIMEOUT;
+  }
+  PROFILE_RXREAD(port);
+  return UART_OK;
 }
 
+//------------UART_InCharTimeout------------
+// Input one character, sleeping at most ms milliseconds for it
+// Input: port number, where to store the character,
+//        time limit in ms (UART_FOREVER for none)
+// Output: UART_OK, or UART_TIMEOUT if nothing arrived in time
+int UART_InCharTimeout(unsigned char port, char *data, unsigned long ms)
+{
+  unsigned long seen, start;
+  start = SysTick_Ms();
+  seen = Event_Seen(&RxData[port]);
+  while(UART_TryInChar(port, data) == UART_TIMEOUT)
+	{
+    if(rxWait(port, seen, start, ms) == EVENT_TIMEOUT)
+		{
+      return UART_TIMEOUT;
+    }
+    seen = Event_Seen(&RxData[port]);
+  }
+  return UART_OK;
+}
 
-// copy from hardware RX FIFO to software RX FIFO
-// stop when hardware RX FIFO is empty or software RX FIFO is full
-void static copyHardwareToSoftware_UART1(void)
+//------------UART_TryRead------------
+// Input up to n bytes that have already arrived, without waiting
+// Input: port number, buffer, its size
+// Output: number of bytes stored, 0 to n
+unsigned short UART_TryRead(unsigned char port, void *buf, unsigned short n)
 {
-  char letter;
-  while(((UART1_FR_R&UART_FR_RXFE) == 0) && (XBeeRxFifo_Size() < (FIFOSIZE - 1)))
+  unsigned short got;
+  got = Ports[port].Rx->GetBlock(buf, n);
+  if(got)
 	{
-    letter = UART1_DR_R;
-    XBeeRxFifo_Put(letter);
+    PROFILE_RXREAD(port);
   }
+  return got;
 }
-// copy from software TX FIFO to hardware TX FIFO
-// stop when software TX FIFO is empty or hardware TX FIFO is full
-void static copySoftwareToHardware_UART1(void)
+
+//------------UART_ReadTimeout------------
+// Input exactly n bytes (any values), sleeping at most ms milliseconds
+// in total for them
+// Input: port number, buffer, its size, time limit in ms (UART_FOREVER for none)
+// Output: number of bytes stored, less than n means it timed out
+unsigned short UART_ReadTimeout(unsigned char port, void *buf, unsigned short n, unsigned long ms)
 {
-  char letter;
-  while(((UART1_FR_R&UART_FR_TXFF) == 0) && (XBeeTxFifo_Size() > 0))
+  char *pt = buf;
+  unsigned short got = 0;
+  unsigned long seen, start;
+  start = SysTick_Ms();
+  seen = Event_Seen(&RxData[port]);
+  while((got = got+UART_TryRead(port, pt+got, n-got)) < n)
 	{
-    XBeeTxFifo_Get(&letter);
-    UART1_DR_R = letter;
+    if(rxWait(port, seen, start, ms) == EVENT_TIMEOUT)
+		{
+      break;
+    }
+    seen = Event_Seen(&RxData[port]);
   }
+  return got;
 }
-// input ASCII character from UART1
-// spin if RxFifo is empty
-unsigned char UART1_InChar(void)
+
+//------------UART_InStringTimeout------------
+// Input characters up to a CR into a NULL-terminated string, without
+// echo or backspace editing (for replies from a device, not a person),
+// sleeping at most ms milliseconds in total; characters beyond max-1
+// and LF are dropped
+// Input: port number, buffer, its size, time limit in ms (UART_FOREVER for none)
+// Output: UART_OK, or UART_TIMEOUT if no CR arrived in time (the
+//   characters that did are in the buffer)
+int UART_InStringTimeout(unsigned char port, char *bufPt, unsigned short max, unsigned long ms)
 {
-  char letter;
-  while(XBeeRxFifo_Get(&letter) == FIFOFAIL){};
-  return(letter);
+  unsigned short length = 0;
+  unsigned long start, left;
+  char character;
+  int status;
+  start = SysTick_Ms();
+  while(1)
+	{
+    left = ms;
+    if(ms != UART_FOREVER)
+		{
+      left = SysTick_Ms()-start;
+      left = (left < ms) ? ms-left : 0;
+    }
+    status = UART_InCharTimeout(port, &character, left);
+    if((status == UART_TIMEOUT) || (character == CR))
+		{
+      break;
+    }
+    if((character != LF) && (length+1 < max))
+		{
+      bufPt[length] = character;
+      length++;
+    }
+  }
+  if(max)
+	{
+    bufPt[length] = 0;
+  }
+  return status;
 }
-// output ASCII character to UART
-// spin if TxFifo is full
-void UART1_OutChar(unsigned char data)
+
+// line mode receive, called by the handler instead of copyHardwareToSoftware
+// edits characters from the hardware RX FIFO into the current line buffer
+// and queues the line when CR or LF arrives; an echo is written straight
+// to the hardware TX FIFO and skipped if it is full
+void static copyHardwareToLine(unsigned char port)
 {
-  while(XBeeTxFifo_Put(data) == FIFOFAIL){};
-  UART1_IM_R &= ~UART_IM_TXIM;          // disable TX FIFO interrupt
-  copySoftwareToHardware_UART1();
-  UART1_IM_R |= UART_IM_TXIM;           // enable TX FIFO interrupt
+  const UartPort *p = &Ports[port];
+  LineState *ls = &Line[port];
+  unsigned char idx;
+  char c, *line;
+  int echo;
+  while((UART_REG(p, UART_FR)&UART_FR_RXFE) == 0)
+	{
+    c = UART_REG(p, UART_DR);
+    if((c == LF) && (ls->Last == CR))
+		{
+      ls->Last = c;                     // LF of a CR LF pair, line already ended
+      continue;
+    }
+    ls->Last = c;
+    if(ls->Cur == NOLINE)
+		{
+      if(LineFreeFifo_Get(&idx) == FIFOFAIL)
+			{
+        ls->Lost++;                     // application is holding every buffer
+        continue;
+      }
+      ls->Cur = idx;
+      ls->Len = 0;
+    }
+    line = LinePool[ls->Cur];
+    echo = 0;
+    if((c == CR) || (c == LF))
+		{
+      line[ls->Len] = 0;
+      p->Lines->Put(ls->Cur);           // never full, it can hold the whole pool
+      ls->Cur = NOLINE;
+      echo = 1;
+    }
+    else if((c == BS) || (c == DEL))
+		{
+      if(ls->Len)
+			{
+        ls->Len--;
+        echo = 1;
+      }
+    }
+    else if(ls->Len < UART_LINESIZE-1)
+		{
+      line[ls->Len] = c;
+      ls->Len++;
+      echo = 1;
+    }
+    if(echo && (ls->Mode&UART_LINE_ECHO) && ((UART_REG(p, UART_FR)&UART_FR_TXFF) == 0))
+		{
+      UART_REG(p, UART_DR) = c;
+    }
+  }
 }
-// at least one of three things has happened:
-// hardware TX FIFO goes from 3 to 2 or less items
-// hardware RX FIFO goes from 1 to 2 or more items
-// UART receiver has timed out
-void UART1_Handler(void)
+
+//------------UART_LineMode------------
+// Turn line mode on or off, see UART2.h
+// Input: port number, UART_LINE_OFF, UART_LINE_ON or UART_LINE_ON+UART_LINE_ECHO
+// Output: 1 on success, 0 if the FIFO arena is out of room
+int UART_LineMode(unsigned char port, unsigned char mode)
 {
-  if(UART1_RIS_R&UART_RIS_TXRIS)
-	{       // hardware TX FIFO <= 2 items
-    UART1_ICR_R = UART_ICR_TXIC;        // acknowledge TX FIFO
-    // copy from software TX FIFO to hardware TX FIFO
-    copySoftwareToHardware_UART1();
-    if(XBeeTxFifo_Size() == 0)
-		{             // software TX FIFO is empty
-      UART1_IM_R &= ~UART_IM_TXIM;      // disable TX FIFO interrupt
+  const UartPort *p = &Ports[port];
+  LineState *ls = &Line[port];
+  unsigned char i;
+  long sr;
+  if(mode && (p->Lines->Capacity() == 0))
+	{
+    if(p->Lines->Init(UART_LINES) == FIFOFAIL)
+		{
+      return(FIFOFAIL);
     }
   }
-  if(UART1_RIS_R&UART_RIS_RXRIS)
-	{       // hardware RX FIFO >= 2 items
-    UART1_ICR_R = UART_ICR_RXIC;        // acknowledge RX FIFO
-    // copy from hardware RX FIFO to software RX FIFO
-    copyHardwareToSoftware_UART1();
+  sr = StartCritical();
+  if(!LinePoolReady)
+	{
+    LineFreeFifo_Init();
+    for(i=0; i<UART_LINES; i++)
+		{
+      LineFreeFifo_Put(i);
+    }
+    LinePoolReady = 1;
   }
-  if(UART1_RIS_R&UART_RIS_RTRIS)
-	{       // receiver timed out
-    UART1_ICR_R = UART_ICR_RTIC;        // acknowledge receiver time out
-    // copy from hardware RX FIFO to software RX FIFO
-    copyHardwareToSoftware_UART1();
+  if((mode == UART_LINE_OFF) && ls->Mode && (ls->Cur != NOLINE))
+	{
+    LineFreeFifo_Put(ls->Cur);          // drop the unfinished line
   }
+  if((mode == UART_LINE_OFF) || (ls->Mode == UART_LINE_OFF))
+	{
+    ls->Cur = NOLINE;                   // start with no buffer when turned on
+    ls->Len = 0;
+    ls->Last = 0;
+  }
+  ls->Mode = mode;
+  EndCritical(sr);
+  return(FIFOSUCCESS);
 }
 
-
-//------------UART1_OutString------------
-// Output String (NULL termination)
-// Input: pointer to a NULL-terminated string to be transferred
-// Output: none
-void UART1_OutString(char *pt)
+//------------UART_TryInLine------------
+// Next completed line, without waiting
+// Input: port number
+// Output: pointer to the NULL-terminated line (give it back with
+//   UART_LineRelease), or 0 if no line is ready
+char *UART_TryInLine(unsigned char port)
 {
-  while(*pt)
+  char idx;
+  if(Ports[port].Lines->Get(&idx) == FIFOFAIL)
 	{
-    UART1_OutChar(*pt);
-    pt++;
+    return 0;
   }
+  PROFILE_RXREAD(port);
+  return LinePool[(unsigned char)idx];
 }
 
-//------------UART1_InUDec------------
-// InUDec accepts ASCII input in unsigned decimal format
-//     and converts to a 32-bit unsigned number
-//     valid range is 0 to 4294967295 (2^32-1)
-// Input: none
-// Output: 32-bit unsigned number
-// If you enter a number above 4294967295, it will return an incorrect value
-// Backspace will remove last digit typed
-unsigned long UART1_InUDec(void)
+//------------UART_InLine------------
+// Next completed line, sleeping until one arrives
+// Input: port number
+// Output: pointer to the NULL-terminated line, give it back with UART_LineRelease
+char *UART_InLine(unsigned char port)
 {
-	unsigned long number=0, length=0;
-	char character;
-  character = UART1_InChar();
-  while(character != CR)
-	{ // accepts until <enter> is typed
-// The next line checks that the input is a digit, 0-9.
-// If the character is not 0-9, it is ignored and not echoed
-    if((character>='0') && (character<='9')) 
-		{
-      number = 10*number+(character-'0');   // this line overflows if above 4294967295
-      length++;
-      UART1_OutChar(character);
-    }
-// If the input is a backspace, then the return number is
-// changed and a backspace is outputted to the screen
-    else if((character==BS) && length)
+  return UART_InLineTimeout(port, UART_FOREVER);
+}
+
+//------------UART_InLineTimeout------------
+// Next completed line, sleeping at most ms milliseconds for one
+// Input: port number, time limit in ms (UART_FOREVER for none)
+// Output: pointer to the NULL-terminated line (give it back with
+//   UART_LineRelease), or 0 if none arrived in time
+char *UART_InLineTimeout(unsigned char port, unsigned long ms)
+{
+  char *line;
+  unsigned long seen, start;
+  start = SysTick_Ms();
+  seen = Event_Seen(&RxData[port]);
+  while((line = UART_TryInLine(port)) == 0)
+	{
+    if(rxWait(port, seen, start, ms) == EVENT_TIMEOUT)
 		{
-      number /= 10;
-      length--;
-      UART1_OutChar(character);
+      return 0;
     }
-    character = UART1_InChar();
+    seen = Event_Seen(&RxData[port]);
   }
-  return number;
+  return line;
 }
 
-//-----------------------UART1_OutUDec-----------------------
-// Output a 32-bit number in unsigned decimal format
-// Input: 32-bit number to be transferred
+//------------UART_LineRelease------------
+// Give a line from UART_InLine or UART_TryInLine back to the pool
+// Input: pointer returned by UART_InLine or UART_TryInLine
 // Output: none
-// Variable format 1-10 digits with no space before or after
-void UART1_OutUDec(unsigned long n)
+void UART_LineRelease(char *line)
 {
-// This function uses recursion to convert decimal number
-//   of unspecified length as an ASCII string
-  if(n >= 10)
+  LineFreeFifo_Put((line-LinePool[0])/UART_LINESIZE);
+}
+
+//------------UART_LineLost------------
+// Characters dropped in line mode because no line buffer was free
+// Input: port number
+// Output: count since the UART was initialized
+unsigned long UART_LineLost(unsigned char port)
+{
+  return Line[port].Lost;
+}
+
+#ifdef UART_PROFILE
+//------------UART_Profile------------
+// Snapshot of the handler timing of the UART, see UART2.h
+// Input: port number, prof points to the structure to fill
+// Output: none
+void UART_Profile(unsigned char port, UartProfile *prof)
+{
+  long sr;
+  sr = StartCritical();
+  *prof = Profile[port];
+  EndCritical(sr);
+}
+
+//------------UART_ResetProfile------------
+// Clear the handler timing of the UART
+// Input: port number
+// Output: none
+void UART_ResetProfile(unsigned char port)
+{
+  UartProfile *pr = &Profile[port];
+  unsigned char i;
+  long sr;
+  sr = StartCritical();
+  for(i=0; i<UART_HISTBINS; i++)
 	{
-    UART1_OutUDec(n/10);
-    n = n%10;
+    pr->Tx[i] = pr->Rx[i] = pr->Rt[i] = pr->Handler[i] = 0;
   }
-  UART1_OutChar(n+'0'); /* n is between 0 and 9 */
+  pr->MaxHandler = pr->MaxRxWait = 0;
+  RxPending[port] = 0;
+  EndCritical(sr);
 }
+#endif
 
-//---------------------UART1_InUHex----------------------------------------
-// Accepts ASCII input in unsigned hexadecimal (base 16) format
-// Input: none
-// Output: 32-bit unsigned number
-// No '$' or '0x' need be entered, just the 1 to 8 hex digits
-// It will convert lower case a-f to uppercase A-F
-//     and converts to a 16 bit unsigned number
-//     value range is 0 to FFFFFFFF
-// If you enter a number above FFFFFFFF, it will return an incorrect value
-// Backspace will remove last digit typed
-unsigned long UART1_InUHex(void)
+#ifdef FIFO_STATS
+//------------UART_FifoStats------------
+// Snapshot of the software FIFO counters of the UART, see FIFO.h
+// Input: port number, rx and tx point to the structures to fill
+// Output: none
+void UART_FifoStats(unsigned char port, FifoStats *rx, FifoStats *tx)
 {
-	unsigned long number=0, digit, length=0;
-	char character;
-  character = UART1_InChar();
-  while(character != CR)
+  Ports[port].Rx->Stats(rx);
+  Ports[port].Tx->Stats(tx);
+}
+
+//------------UART_ResetFifoStats------------
+// Clear the software FIFO counters of the UART
+// Input: port number
+// Output: none
+void UART_ResetFifoStats(unsigned char port)
+{
+  Ports[port].Rx->ResetStats();
+  Ports[port].Tx->ResetStats();
+  Overruns[port] = 0;
+}
+
+//------------UART_RxOverruns------------
+// Number of overrun errors, each one a received byte lost because the
+//   hardware RX FIFO was full (the software RX FIFO was full, or the
+//   handler ran too late), since init or UART_ResetFifoStats
+// Input: port number
+// Output: count of overruns, at most one per handler call
+unsigned long UART_RxOverruns(unsigned char port)
+{
+  return Overruns[port];
+}
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// UART1 transmit queues for the XBEE/////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////
+// The transmitter only switches between the two rings at frame
+// boundaries.  Each frame is described by a mark giving the ring index
+// where it ends and the value of TxSent when it was queued, so the wait
+// can be measured in bytes that went out ahead of it.
+typedef struct{
+  unsigned long End;      // ring index one past the last byte of the frame
+  unsigned long Stamp;    // TxSent when the frame was queued
+} txFrameMark;
+#define TXMARKS    16     // bulk frames that can be waiting
+#define TXHIMARKS   8     // high priority frames that can be waiting
+AddIndexFifo(XBeeTxMark, TXMARKS, txFrameMark, FIFOSUCCESS, FIFOFAIL)
+AddIndexFifo(XBeeTxHiMark, TXHIMARKS, txFrameMark, FIFOSUCCESS, FIFOFAIL)
+#define TXIDLE 0          // between frames, free to pick either ring
+#define TXHI   1          // sending a high priority frame
+#define TXBULK 2          // sending a bulk frame or unframed bytes
+unsigned long static TxSent;       // bytes written to the hardware TX FIFO
+unsigned long static TxFrameEnd;   // ring index where the current frame ends
+unsigned char static TxQueue;      // TXIDLE, TXHI or TXBULK
+unsigned char static TxHiRun;      // high priority frames sent while bulk waited
+TxQueueStats static TxHiStats;
+TxQueueStats static TxBulkStats;
+#ifdef UART1_CTS
+unsigned long static CtsPauses;    // times the XBee deasserted CTS
+#endif
+
+// UART1 setup before its RX and TX FIFOs, adds the high priority ring
+int static openXBee(void)
+{
+  if(XBeeTxHiFifo_Init(UART1_TXHIFIFOSIZE) == FIFOFAIL)
+	{
+    return(FIFOFAIL);                   // bad size or arena out of room
+  }
+  XBeeTxMarkFifo_Init();
+  XBeeTxHiMarkFifo_Init();
+  TxQueue = TXIDLE;
+  TxHiRun = 0;
+  TxSent = 0;
+  UART1_ResetTxQueueStats();
+#ifdef UART1_CTS
+  CtsPauses = 0;
+  SYSCTL_RCGC2_R |= UART1_CTS_RCGC;     // activate the GPIO port of CTS
+  (void)SYSCTL_RCGC2_R;                 // allow time for the clock to start
+  CTS_REG(GPIO_DIR) &= ~UART1_CTS_PIN;  // input
+  CTS_REG(GPIO_AFSEL) &= ~UART1_CTS_PIN;
+  CTS_REG(GPIO_DEN) |= UART1_CTS_PIN;
+  CTS_REG(GPIO_IS) &= ~UART1_CTS_PIN;   // edge sensitive
+  CTS_REG(GPIO_IBE) |= UART1_CTS_PIN;   // on both edges
+  CTS_REG(GPIO_ICR) = UART1_CTS_PIN;    // clear a stale edge
+  CTS_REG(GPIO_IM) |= UART1_CTS_PIN;    // arm the interrupt
+                                        // same priority as the UARTs, so
+                                        // it never preempts their handlers
+  NVIC_PRI_R(UART1_CTS_IRQ) = UART_PRIORITY<<5;
+  NVIC_EN_R(UART1_CTS_IRQ) = 1<<(UART1_CTS_IRQ&31);
+#endif
+  return(FIFOSUCCESS);
+}
+// count one frame leaving its queue
+void static txQueueWait(TxQueueStats *st, unsigned long stamp)
+{
+  unsigned long wait;
+  wait = TxSent-stamp;                  // bytes sent since it was queued
+  st->Frames++;
+  st->TotalWait += wait;
+  if(wait > st->MaxWait)
+	{
+    st->MaxWait = wait;
+  }
+}
+// pick the next frame to send, called between frames only
+// high priority frames go first, but after UART1_TXSTARVE of them in a
+// row while bulk data was waiting one bulk frame is let through
+// returns 0 if both queues are empty
+int static txNextFrame_XBee(void)
+{
+  txFrameMark mark;
+  int bulkReady;
+  bulkReady = XBeeTxMarkFifo_Size() || (XBeeTxPutI != XBeeTxGetI);
+  if(XBeeTxHiMarkFifo_Size() && (!bulkReady || (TxHiRun < UART1_TXSTARVE)))
 	{
-    digit = 0x10; // assume bad
-    if((character>='0') && (character<='9'))
+    XBeeTxHiMarkFifo_Get(&mark);
+    TxQueue = TXHI;
+    TxFrameEnd = mark.End;
+    txQueueWait(&TxHiStats, mark.Stamp);
+    if(bulkReady)
+		{
+      TxHiRun++;
+    }
+    return 1;
+  }
+  if(bulkReady)
+	{
+    TxQueue = TXBULK;
+    TxHiRun = 0;
+    if(XBeeTxMarkFifo_Get(&mark))
+		{                                   // also carries any unframed bytes before it
+      TxFrameEnd = mark.End;
+      txQueueWait(&TxBulkStats, mark.Stamp);
+    }
+    else
 		{
-      digit = character-'0';
+      TxFrameEnd = XBeeTxPutI;          // bytes written without UART1_TxBeginFrame
     }
-    else if((character>='A') && (character<='F'))
+    return 1;
+  }
+  return 0;
+}
+// UART1 copy from software TX FIFOs to hardware TX FIFO, a whole frame at a time
+// stop when both software TX FIFOs are empty, the current frame is not
+// fully written yet, or hardware TX FIFO is full
+// returns nonzero if bytes are left in either software TX FIFO
+int static copySoftwareToHardware_XBee(const UartPort *p)
+{
+  char *pt;
+  unsigned short n, i;
+#ifdef UART1_CTS
+  if(CTS_HIGH())
+	{           // the XBee buffer is full, the CTS edge handler resumes
+    return XBeeTxFifo_Size() || XBeeTxHiFifo_Size();
+  }
+#endif
+  while((UART_REG(p, UART_FR)&UART_FR_TXFF) == 0)
+	{
+    if((TxQueue == TXIDLE) && !txNextFrame_XBee())
 		{
-      digit = (character-'A')+0xA;
+      break;                            // nothing queued
     }
-    else if((character>='a') && (character<='f'))
+    if(TxQueue == TXHI)
 		{
-      digit = (character-'a')+0xA;
+      n = (unsigned short)(TxFrameEnd-XBeeTxHiGetI);
+      pt = XBeeTxHiFifo_Peek(&n);       // send straight from the ring
+      for(i=0; (i < n) && ((UART_REG(p, UART_FR)&UART_FR_TXFF) == 0); i++)
+			{
+        UART_REG(p, UART_DR) = pt[i];
+      }
+      XBeeTxHiFifo_Consume(i);
+      if(XBeeTxHiGetI == TxFrameEnd)
+			{
+        TxQueue = TXIDLE;
+      }
     }
-// If the character is not 0-9 or A-F, it is ignored and not echoed
-    if(digit <= 0xF)
+    else
 		{
-      number = number*0x10+digit;
-      length++;
-      UART1_OutChar(character);
+      n = (unsigned short)(TxFrameEnd-XBeeTxGetI);
+      pt = XBeeTxFifo_Peek(&n);         // send straight from the ring
+      for(i=0; (i < n) && ((UART_REG(p, UART_FR)&UART_FR_TXFF) == 0); i++)
+			{
+        UART_REG(p, UART_DR) = pt[i];
+      }
+      XBeeTxFifo_Consume(i);
+      if(XBeeTxGetI == TxFrameEnd)
+			{
+        TxQueue = TXIDLE;
+      }
     }
-// Backspace outputted and return value changed if a backspace is inputted
-    else if((character==BS) && length)
+    TxSent += i;
+    if((TxQueue != TXIDLE) && (i == 0))
 		{
-      number /= 0x10;
-      length--;
-      UART1_OutChar(character);
+      break;                            // rest of the frame not written yet
     }
-    character = UART1_InChar();
   }
-  return number;
+  return XBeeTxFifo_Size() || XBeeTxHiFifo_Size();
 }
 
-//--------------------------UART1_OutUHex----------------------------
-// Output a 32-bit number in unsigned hexadecimal format
-// Input: 32-bit number to be transferred
+#ifdef UART1_CTS
+//------------UART1_CtsEdge------------
+// CTS flow control, see UART2.h
+// Input: none
 // Output: none
-// Variable format 1 to 8 digits with no space before or after
-void UART1_OutUHex(unsigned long number)
+void UART1_CtsEdge(void)
 {
-// This function uses recursion to convert the number of
-//   unspecified length as an ASCII string
-  if(number >= 0x10)
+  const UartPort *p = &Ports[UART_PORT1];
+  CTS_REG(GPIO_ICR) = UART1_CTS_PIN;    // acknowledge
+  if(CTS_HIGH())
 	{
-    UART1_OutUHex(number/0x10);
-    UART1_OutUHex(number%0x10);
+    CtsPauses++;                        // the next refill will hold off
   }
   else
+	{                                     // room in the XBee again
+    copySoftwareToHardware_XBee(p);
+    Event_Post(&TxSpace[UART_PORT1]);
+  }
+}
+
+#ifdef UART1_CTS_HANDLER
+void UART1_CTS_HANDLER(void)
+{
+  UART1_CtsEdge();
+}
+#endif
+
+//------------UART1_CtsPauses------------
+// Number of times the XBee has held off UART1 with CTS
+// Input: none
+// Output: count since UART1 was initialized
+unsigned long UART1_CtsPauses(void)
+{
+  return CtsPauses;
+}
+#endif
+
+//------------UART1_TxBeginFrame------------
+// Mark the next n bytes written to the UART1 TX FIFO (by OutChar,
+//   OutString or TxReserve/TxCommit) as one bulk frame, so that no
+//   high priority frame is sent in the middle of it
+// Input: number of bytes in the frame
+// Output: 1 on success, 0 if too many bulk frames are already waiting
+int UART1_TxBeginFrame(unsigned short n)
+{
+  txFrameMark mark;
+  mark.End = XBeeTxPutI+n;
+  mark.Stamp = TxSent;
+  return XBeeTxMarkFifo_Put(mark);
+}
+
+//------------UART1_TxBeginFrameWait------------
+// Like UART1_TxBeginFrame, but sleeps until the handler posts while
+//   too many bulk frames are waiting
+// Input: number of bytes in the frame
+// Output: none
+void UART1_TxBeginFrameWait(unsigned short n)
+{
+  unsigned long seen;
+  seen = Event_Seen(&TxSpace[UART_PORT1]);
+  while(UART1_TxBeginFrame(n) == FIFOFAIL)
 	{
-    if(number < 0xA)
-		{
-      UART1_OutChar(number+'0');
-    }
-    else
-		{
-      UART1_OutChar((number-0x0A)+'A');
-    }
+    Event_Wait(&TxSpace[UART_PORT1], seen, EVENT_FOREVER);
+    seen = Event_Seen(&TxSpace[UART_PORT1]);
   }
 }
 
-//------------UART1_InString------------
-// Accepts ASCII characters from the serial port
-//    and adds them to a string until <enter> is typed
-//    or until max length of the string is reached.
-// It echoes each character as it is inputted.
-// If a backspace is inputted, the string is modified
-//    and the backspace is echoed
-// terminates the string with a null character
-// uses busy-waiting synchronization on RDRF
-// Input: pointer to empty buffer, size of buffer
-// Output: Null terminated string
-// -- Modified by Agustinus Darmawan + Mingjie Qiu --
-void UART1_InString(char *bufPt, unsigned short max) 
+//------------UART1_TxHiFrame------------
+// Queue a whole frame ahead of the bulk data, it is sent as soon as
+//   the frame being sent now is finished
+// Input: pointer to the frame, number of bytes
+// Output: 1 on success, 0 if it does not fit right now (nothing queued)
+int UART1_TxHiFrame(const char *frame, unsigned short n)
 {
-	int length=0;
-	char character;
-  character = UART1_InChar();
-  while(character != CR)
+  txFrameMark mark;
+  if((XBeeTxHiMarkFifo_Size() == TXHIMARKS) ||
+     (n > XBeeTxHiFifo_Capacity()-XBeeTxHiFifo_Size()))
 	{
-    if(character == BS)
-		{
-      if(length)
-			{
-        bufPt--;
-        length--;
-        UART1_OutChar(BS);
-      }
-    }
-    else if(length < max)
-		{
-      *bufPt = character;
-      bufPt++;
-      length++;
-      UART1_OutChar(character);
-    }
-    character = UART1_InChar();
+    return(FIFOFAIL);
   }
-  *bufPt = 0;
+  XBeeTxHiFifo_PutBlock(frame, n);
+  mark.End = XBeeTxHiPutI;
+  mark.Stamp = TxSent;
+  XBeeTxHiMarkFifo_Put(mark);           // publish only once the bytes are in
+  startTx(&Ports[UART_PORT1]);
+  return(FIFOSUCCESS);
+}
+
+//------------UART1_TxHiFrameWait------------
+// Like UART1_TxHiFrame, but sleeps until the handler posts while the
+//   frame does not fit
+// Input: pointer to the frame, number of bytes
+// Output: 1 on success, 0 if it could never fit (nothing queued)
+int UART1_TxHiFrameWait(const char *frame, unsigned short n)
+{
+  unsigned long seen;
+  if(n > XBeeTxHiFifo_Capacity())
+	{
+    return(FIFOFAIL);
+  }
+  seen = Event_Seen(&TxSpace[UART_PORT1]);
+  while(UART1_TxHiFrame(frame, n) == FIFOFAIL)
+	{
+    Event_Wait(&TxSpace[UART_PORT1], seen, EVENT_FOREVER);
+    seen = Event_Seen(&TxSpace[UART_PORT1]);
+  }
+  return(FIFOSUCCESS);
+}
+
+//------------UART1_TxQueueStats------------
+// Snapshot of the UART1 transmit queue latency counters
+// Input: hi and bulk point to the structures to fill
+// Output: none
+void UART1_TxQueueStats(TxQueueStats *hi, TxQueueStats *bulk)
+{
+  long sr;
+  sr = StartCritical();
+  *hi = TxHiStats;
+  *bulk = TxBulkStats;
+  EndCritical(sr);
+}
+
+//------------UART1_ResetTxQueueStats------------
+// Clear the UART1 transmit queue latency counters
+// Input: none
+// Output: none
+void UART1_ResetTxQueueStats(void)
+{
+  long sr;
+  sr = StartCritical();
+  TxHiStats.Frames = TxHiStats.MaxWait = TxHiStats.TotalWait = 0;
+  TxBulkStats.Frames = TxBulkStats.MaxWait = TxBulkStats.TotalWait = 0;
+  EndCritical(sr);
 }
@@ -2,15 +2,81 @@
 #include "Xbee.h"
 #include "systick.h"
 #include "UART2.h"
+#include "XBeeApi.h"
 
 #define NULL 0
-static void sendATCommand(char* input);
+#define XBEE_CLOCK 50000000  // bus clock that UART1 runs from, Hz
+#define XBEE_ATTIMEOUT 500   // ms to wait for the reply to an AT command
+#define XBEE_ATTRIES   3     // times an AT command is sent before giving up
+#define XBEE_TXTIMEOUT 500   // ms to wait for the TX status of a frame
+#define XBEE_APITIMEOUT 100  // ms to wait for the replies to API AT frames
+#define XBEE_MY        0x4E  // my address, ATMY
+#define SETTINGS       4     // entries in Settings
+static int commandModeInit(void);
+static int apiInit(void);
+static int sendATCommand(char* input);
+static int atReply(void);
+static char *baudCommand(unsigned long baud);
+static int baudIndex(unsigned long baud);
+static void atResponse(const unsigned char *frame, unsigned short length);
+static void txStatus(const unsigned char *frame, unsigned short length);
 
 unsigned char destination[2] = {0x00,0x4F};
-unsigned char startDelimiter = 0x7E;
 unsigned char opt = 0x00;
+static unsigned char LastID;   // frame ID of the last TX frame sent
+static unsigned char StatusID; // frame ID of the last TX status received
+static unsigned char Status;   // its status byte, 0 for success
+static unsigned char Answered;  // the XBee replied to the API probe
+static unsigned char AtReplied; // bit per frame ID 1 to 7 with an AT response
+static unsigned char AtGood;    // bit per frame ID whose response was OK
+static unsigned long AtValue[8]; // value in each response, by frame ID
 
-void XBee_Init(void)
+// what XBee_Init sets up, in the order the API AT frames are sent
+static struct{
+	char Command[3];
+	unsigned char Size;  // parameter bytes
+	unsigned long Value;
+} Settings[SETTINGS] = {
+	{"AP", 1, 1},        // API mode 1
+	{"MY", 2, XBEE_MY},  // my address is 78
+	{"DL", 4, 0},        // destination address, from destination[]
+	{"DH", 4, 0}         // destination high address is 0
+};
+
+// returns 1 if the XBee is ready, 0 if it could not be reached
+// A module already in API mode (with XBEE_SAVE, every boot after the
+// first) is checked and set up with API AT frames, all sent at once,
+// which takes milliseconds; command mode, with its two 1.1 s guard
+// times, is only used when nothing answers them.
+int XBee_Init(void)
+{
+	int ready;
+	Answered = 0;
+	XBeeApi_Register(XBEE_API_ATRESPONSE, atResponse);
+	ready = apiInit();
+	if(!ready && !Answered && (XBEE_BAUD != UART1_BAUD))
+	{ // saved with ATWR it comes up at XBEE_BAUD
+		UART1_SetBaud(XBEE_CLOCK, XBEE_BAUD);
+		ready = apiInit();
+		if(!ready && !Answered)
+		{
+			UART1_SetBaud(XBEE_CLOCK, UART1_BAUD);
+		}
+	}
+	if(!ready && !Answered)
+	{ // an XBee that answered in API mode and then failed is not retried
+		ready = commandModeInit();
+	}
+	if(ready)
+	{
+		XBeeApi_Register(XBEE_API_TXSTATUS, txStatus);
+	}
+	return ready;
+}
+
+// enters AT command mode and sets up addressing and API mode
+// returns 1 if the XBee answered every command, 0 if it stopped answering
+static int commandModeInit(void)
 {
 	UART1_OutChar('X');     // send to XBee
 	UART0_OutChar('X');     // echo to user
@@ -19,18 +85,190 @@ void XBee_Init(void)
 	UART0_OutString("+++"); // echo to user
 	SysTick_Wait10ms(110);  // guard time delay
 	
-	// not sure how to retrieve CR response
-	UART0_OutChar(UART1_InChar()); // think this get the OK<CR> response
-	sendATCommand("ATDL4F");  // sets destination address to 79 	
-	sendATCommand("ATDH0"); OutCRLF_UART0();  // sets destination high address to 0
-//	UART0_OutChar(UART1_InChar()); // think this get the OK<CR> response
-	sendATCommand("ATMY4E"); OutCRLF_UART0(); // sets my address to 78
-//	UART0_OutChar(UART1_InChar()); // think this get the OK<CR> response
-	sendATCommand("ATAP1"); OutCRLF_UART0();  // set for API mode 1
-//	UART0_OutChar(UART1_InChar()); // think this get the OK<CR> response
-	sendATCommand("ATCN"); OutCRLF_UART0();   // ends the AT Command mode
-//	UART0_OutChar(UART1_InChar()); // think this get the OK<CR> response
-	// also check ATBD == 3 to make sure the baud rate is set at 9600 bits/sec
+	if(!atReply())            // OK<CR> response
+	{
+		return 0;               // no radio, or it did not enter command mode
+	}
+	if(!sendATCommand("ATDL4F") ||  // sets destination address to 79
+	   !sendATCommand("ATDH0") ||   // sets destination high address to 0
+	   !sendATCommand("ATMY4E") ||  // sets my address to 78
+	   !sendATCommand("ATAP1"))     // set for API mode 1
+	{
+		return 0;
+	}
+	if(XBEE_SAVE && !sendATCommand("ATWR")) // keep them for the next boot
+	{
+		return 0;
+	}
+	if((XBEE_BAUD != UART1_Baud()) && baudCommand(XBEE_BAUD))
+	{ // new interface rate, the XBee switches to it when command mode ends
+		if(!sendATCommand(baudCommand(XBEE_BAUD)) || !sendATCommand("ATCN"))
+		{
+			return 0;
+		}
+		UART1_SetBaud(XBEE_CLOCK, XBEE_BAUD); // switch our end to match
+	}
+	else if(!sendATCommand("ATCN")) // ends the AT Command mode
+	{
+		return 0;
+	}
+	OutCRLF_UART0();
+	return 1;
+}
+
+// sends every entry of Settings as an API AT frame, then waits for
+// all the replies; write 0 reads each setting, write 1 sets it
+// returns a bit per setting (bit 0 for Settings[0]) that was OK and,
+// when reading, already had the wanted value
+static unsigned char apiSettings(int write)
+{
+	unsigned char param[4];
+	unsigned char ids = 0;
+	unsigned char ok = 0;
+	unsigned long start, elapsed;
+	int i, j;
+	AtReplied = AtGood = 0;
+	for(i = 0; i < SETTINGS; i++)
+	{
+		for(j = 0; j < Settings[i].Size; j++) // most significant byte first
+		{
+			param[j] = Settings[i].Value>>(8*(Settings[i].Size-1-j));
+		}
+		XBeeApi_At(i+1, Settings[i].Command, param, write ? Settings[i].Size : 0);
+		ids |= 1<<(i+1);
+	}
+	start = SysTick_Ms();
+	elapsed = 0;
+	while(((AtReplied&ids) != ids) && (elapsed < XBEE_APITIMEOUT))
+	{
+		XBeeApi_Wait(XBEE_APITIMEOUT-elapsed);
+		elapsed = SysTick_Ms()-start;
+	}
+	for(i = 0; i < SETTINGS; i++)
+	{
+		if((AtGood & (1<<(i+1))) && (write || (AtValue[i+1] == Settings[i].Value)))
+		{
+			ok |= 1<<i;
+		}
+	}
+	return ok;
+}
+
+// one API AT frame with a 1-byte parameter, or none if size is 0
+// returns 1 if the XBee replied OK within XBEE_APITIMEOUT
+static int apiCommand(char *command, unsigned char param, unsigned char size)
+{
+	unsigned long start, elapsed;
+	AtReplied = AtGood = 0;
+	XBeeApi_At(SETTINGS+1, command, &param, size);
+	start = SysTick_Ms();
+	elapsed = 0;
+	while(!(AtReplied & (1<<(SETTINGS+1))) && (elapsed < XBEE_APITIMEOUT))
+	{
+		XBeeApi_Wait(XBEE_APITIMEOUT-elapsed);
+		elapsed = SysTick_Ms()-start;
+	}
+	return (AtGood & (1<<(SETTINGS+1))) != 0;
+}
+
+// checks the settings in API mode at the current UART1 rate and sets
+// whichever differ; returns 1 if the XBee is ready, 0 if not, with
+// Answered 0 if nothing answered (not in API mode, or another rate)
+static int apiInit(void)
+{
+	const unsigned char all = (1<<SETTINGS)-1;
+	unsigned char ok;
+	int changed = 0;
+	Settings[2].Value = (destination[0]<<8)+destination[1];
+	XBeeApi_Poll(); // drop whatever came in before
+	ok = apiSettings(0);
+	if(AtReplied == 0)
+	{
+		return 0;
+	}
+	Answered = 1;     // from here on a failure is not "no API radio"
+	if(ok != all)
+	{
+		if(apiSettings(1) != all)
+		{
+			return 0;
+		}
+		changed = 1;
+	}
+	if((XBEE_BAUD != UART1_Baud()) && (baudIndex(XBEE_BAUD) >= 0))
+	{ // the XBee switches once its reply has gone out
+		if(!apiCommand("BD", baudIndex(XBEE_BAUD), 1))
+		{
+			return 0;
+		}
+		UART1_SetBaud(XBEE_CLOCK, XBEE_BAUD); // switch our end to match
+		changed = 1;
+	}
+	if(XBEE_SAVE && changed && !apiCommand("WR", 0, 0))
+	{
+		return 0;
+	}
+	UART0_OutString("XBee API ready");
+	OutCRLF_UART0();
+	return 1;
+}
+
+// XBEE_API_ATRESPONSE handler: API identifier, frame ID, command, status, value
+static void atResponse(const unsigned char *frame, unsigned short length)
+{
+	unsigned long value = 0;
+	unsigned short i;
+	unsigned char id;
+	if(length < 5)
+	{
+		return;
+	}
+	id = frame[1];
+	if((id == 0) || (id > 7))
+	{
+		return;
+	}
+	for(i = 5; i < length; i++)
+	{
+		value = (value<<8)+frame[i];
+	}
+	AtValue[id] = value;
+	AtReplied |= 1<<id;
+	if(frame[4] == 0) // 0 OK, 1 ERROR, 2 invalid command, 3 invalid parameter
+	{
+		AtGood |= 1<<id;
+	}
+}
+
+// ATBD command for one of the standard XBee interface rates, or 0
+// the XBee is not told to save it (no ATWR), so it is back at 9600
+// after a power cycle, which is where UART1_Init starts as well
+static char *baudCommand(unsigned long baud)
+{
+	static char command[6] = "ATBD0";
+	if(baudIndex(baud) < 0)
+	{
+		return 0;
+	}
+	command[4] = '0'+baudIndex(baud);
+	return command;
+}
+
+// ATBD parameter of one of the standard XBee interface rates, or -1
+static int baudIndex(unsigned long baud)
+{
+	switch(baud)
+	{
+		case 1200:   return 0;
+		case 2400:   return 1;
+		case 4800:   return 2;
+		case 9600:   return 3;
+		case 19200:  return 4;
+		case 38400:  return 5;
+		case 57600:  return 6;
+		case 115200: return 7;
+	}
+	return -1;
 }
 
 
@@ -38,11 +276,35 @@ void XBee_Init(void)
 //This routine receives the various parameters associated with an AT command as input then transmits the formatted
 //command to the XBee module. After a blind-cycle delay, the routine checks if the command has been successfully
 //received by determining if the module has returned the OK character string.
-static void sendATCommand(char* input)
+// returns 1 if the XBee answered OK, 0 after XBEE_ATTRIES tries without
+static int sendATCommand(char* input)
 {
-	UART1_OutString(input);	
-	OutCRLF_UART0();
-	UART0_OutChar(UART1_InChar()); // think this get the OK<CR> response
+	int try;
+	for(try = 0; try < XBEE_ATTRIES; try++)
+	{
+		UART1_OutString(input);
+		UART1_OutChar(CR);       // the XBee runs the command on <CR>
+		OutCRLF_UART0();
+		if(atReply())
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// reads one reply line up to its <CR>, echoes it to the user
+// returns 1 if it was OK, 0 if it was not or none came within XBEE_ATTIMEOUT
+static int atReply(void)
+{
+	char reply[8];
+	if(UART1_InStringTimeout(reply, sizeof(reply), XBEE_ATTIMEOUT) == UART_TIMEOUT)
+	{
+		UART0_OutString("timeout");
+		return 0;
+	}
+	UART0_OutString(reply);
+	return (reply[0] == 'O') && (reply[1] == 'K') && (reply[2] == 0);
 }
 
 
@@ -53,27 +315,45 @@ static void sendATCommand(char* input)
 //LM3S1968 via an API transmit status frame. This routine returns a 1 if the transmission was successful and a 0
 //otherwise. The following figure shows a response the XBee returns after the transmitter sends a TxFrame that was
 //properly received by the other computer, measured on XBee pin 2 Dout.
+// The status frame is picked out of the receive stream by XBeeApi, so
+// anything else the XBee sends meanwhile goes to its own handler.
 int XBee_TxStatus(void)
 {
+	unsigned long start, elapsed;
+	start = SysTick_Ms();
+	elapsed = 0;
+	while(StatusID != LastID)
+	{
+		if(elapsed >= XBEE_TXTIMEOUT)
+		{
+			return 0; // if error, no status came
+		}
+		XBeeApi_Wait(XBEE_TXTIMEOUT-elapsed);
+		elapsed = SysTick_Ms()-start;
+	}
+	return Status == 0; // 0 means the destination acknowledged it
+}
 
-
-
-	return 0; // if error
-	//return 1; // if successful
+// XBEE_API_TXSTATUS handler: API identifier, frame ID, status
+static void txStatus(const unsigned char *frame, unsigned short length)
+{
+	if(length >= 3)
+	{
+		Status = frame[2];
+		StatusID = frame[1];
+	}
 }
 //-------------------------------------------------------------------------------------------------
 void XBee_SendTxFrame(void)
 {
-	char* XbeeString;
 	char string[25] = {0};
 	
 	
 	UART0_OutString("InString0: ");
   UART0_InString(&string[0],19);
-	XbeeString = XBee_CreateTxFrame(&string[0]);
-	UART1_OutString(XbeeString); OutCRLF_UART1();
+	XBee_CreateTxFrame(&string[0]);
 	
-	if(!XBee_TxStatus)
+	if(!XBee_TxStatus())
 	{
 		UART0_OutString("Error, acknolwdge not received"); OutCRLF_UART0();
 	}
@@ -81,63 +361,26 @@ void XBee_SendTxFrame(void)
 	
 }
 //-------------------------------------------------------------------------------------------------
-char* XBee_CreateTxFrame(char* string)
+// sends string as an API TX 16-bit frame, returns the frame ID used
+// the string is cut at XBEE_PAYLOADMAX, the largest RF payload
+unsigned char XBee_CreateTxFrame(char* string)
 {
 	static unsigned char ID = 1;
-	int i;
-	unsigned short length;
-	static unsigned char message[25];
+	unsigned char frameID;
 	unsigned short numBytes;
-	unsigned char checksum;
-	unsigned char sum;
 	
-	// zero message buffer
-	for(i=0;i<25;i++)
-	{
-		message[i] = 0;
-	}
-	
-	numBytes = 0;
-	// should I look for <CR> instead of the null?
-	// I am not sure how it stores the values from the UART
-	while(*string != CR)
-	{
-		numBytes++;
-	}
-	length = numBytes+5; // 5 counts for the API, ID, Destination, & OPT bytes
-	
-	//for(numBytes = 0; *string != NULL; numBytes++){}	
-	
-	
-	message[0] = startDelimiter;
-	message[1] = (unsigned char)((length & 0xFF00)>>8); // get top byte of length
-	message[2] = (unsigned char)(length & 0x00FF); // get lower byte of length
-	message[3] = 0x01; // API mode 1
-	message[4] = ID;
-	message[5] = destination[0];
-	message[6] = destination[1];
-	message[7] = opt;
-	
-	for(i=0; i<numBytes; i++)
-	{
-		// fill the message array
-		message[8+i] = string[i];		
-	}
+	// InString null terminates the line, the <CR> is not stored
+	for(numBytes = 0; (numBytes < XBEE_PAYLOADMAX) && (string[numBytes] != NULL); numBytes++){}
 	
+	frameID = ID;
+	LastID = ID;
+	StatusID = 0;    // no status for it yet, IDs are never 0
 	ID = (ID+1)%256; // keep in range of an unsigned char
 	if(ID == 0)
 	{
 		ID = 1; // make sure the ID never equals zero
 	}
 	
-	sum = message[3]+message[4]+message[5]+message[6]+message[7];
-	
-	for(i=0; i < numBytes; i++)
-	{
-		sum += message[i+8];
-	}
-	checksum = 0xFF-sum;
-	message[numBytes+9] = checksum;
-	return &message[0];
+	XBeeApi_Tx16(frameID, (destination[0]<<8)+destination[1], opt, string, numBytes);
+	return frameID;
 }
-//-------------------------------------------------------------------------------------------------
@@ -0,0 +1,322 @@
+// XBeeApi.c
+// Runs on LM3S1968
+// XBee API mode 1 frames on UART1, see XBeeApi.h
+// Raw holds what came after the 0x7E being tried: the two length bytes,
+// the frame data and the checksum.  When that turns out not to be a
+// frame, Raw is copied in front of any bytes still waiting in Replay and
+// they are all fed through the state machine again, so no byte after a
+// false 0x7E is lost while the real one is found.  Every byte in Replay
+// came out of one Raw, so Replay never needs to be bigger than Raw.
+// A TX request is announced to UART1 as one frame of known size
+// (UART1_TxBeginFrameWait), so priority frames cannot split it, and
+// then written through UART1_TxReserveWait/UART1_TxCommit spans as it
+// goes; both sleep on the UART1 TX event while the ring is full.
+// AT command frames are short and built whole on the stack, then go
+// through the UART1 high priority queue so bulk data cannot delay them.
+
+#include "XBeeApi.h"
+#include "UART2.h"
+
+#define RAWMAX (XBEEAPI_FRAMEMAX+3)     // length, frame data, checksum
+#define POLLCHUNK 16                    // bytes taken from UART1 at a time
+
+unsigned char static Raw[RAWMAX];       // bytes after the 0x7E being tried
+unsigned short static RawN;             // bytes in Raw
+unsigned short static Length;           // frame data bytes, once RawN >= 2
+unsigned char static InFrame;           // a 0x7E has been seen
+unsigned char static Replay[RAWMAX];    // bytes to go through again
+unsigned short static ReplayI, ReplayN; // next one and end
+XBeeApiStats static Stats;
+char static *TxSpan;                    // span reserved in the UART1 TX FIFO
+unsigned short static TxRoom;           // bytes granted in TxSpan
+unsigned short static TxUsed;           // bytes written into TxSpan
+unsigned short static TxLeft;           // bytes still to come in this frame
+unsigned char static TxSum;             // frame data bytes added so far
+struct{
+  unsigned char Api;
+  XBeeFrameHandler Handler;             // 0 for a free entry
+} static Handlers[XBEEAPI_HANDLERS];
+
+int XBeeApi_Register(unsigned char api, XBeeFrameHandler handler)
+{
+  int i, open = -1;
+  for(i=0; i<XBEEAPI_HANDLERS; i++)
+  {
+    if(Handlers[i].Handler && (Handlers[i].Api == api))
+    {
+      Handlers[i].Handler = handler;    // replace, or remove with 0
+      return 1;
+    }
+    if((Handlers[i].Handler == 0) && (open < 0))
+    {
+      open = i;
+    }
+  }
+  if(handler == 0)
+  {
+    return 1;                           // nothing to remove
+  }
+  if(open < 0)
+  {
+    return 0;
+  }
+  Handlers[open].Api = api;
+  Handlers[open].Handler = handler;
+  return 1;
+}
+
+// the 0x7E at the start of Raw was data, search the bytes after it again
+void static resync(void)
+{
+  unsigned short rest, i;
+  rest = ReplayN-ReplayI;
+  if(RawN+rest > RAWMAX)
+  {                                     // cannot happen, see above
+    rest = RAWMAX-RawN;
+  }
+  if(RawN > ReplayI)
+  {                                     // moving up, copy from the top
+    for(i=rest; i>0; i--)
+    {
+      Replay[RawN+i-1] = Replay[ReplayI+i-1];
+    }
+  }
+  else
+  {
+    for(i=0; i<rest; i++)
+    {
+      Replay[RawN+i] = Replay[ReplayI+i];
+    }
+  }
+  for(i=0; i<RawN; i++)
+  {
+    Replay[i] = Raw[i];
+  }
+  ReplayI = 0;
+  ReplayN = RawN+rest;
+  InFrame = 0;
+}
+
+// hand a good frame to its handler
+void static dispatch(void)
+{
+  int i;
+  Stats.Frames++;
+  for(i=0; i<XBEEAPI_HANDLERS; i++)
+  {
+    if(Handlers[i].Handler && (Handlers[i].Api == Raw[2]))
+    {
+      Handlers[i].Handler(&Raw[2], Length);
+      return;
+    }
+  }
+  Stats.Unhandled++;
+}
+
+// the frame state machine
+void static step(unsigned char data)
+{
+  unsigned short i;
+  unsigned char sum;
+  if(!InFrame)
+  {
+    if(data == XBEE_DELIMITER)
+    {
+      InFrame = 1;
+      RawN = 0;
+    }
+    else
+    {
+      Stats.Skipped++;
+    }
+    return;
+  }
+  Raw[RawN] = data;
+  RawN++;
+  if(RawN == 2)
+  {
+    Length = (Raw[0]<<8)+Raw[1];
+    if((Length == 0) || (Length > XBEEAPI_FRAMEMAX))
+    {
+      Stats.BadLength++;
+      resync();
+    }
+    return;
+  }
+  if((RawN < 2) || (RawN < Length+3))
+  {
+    return;                             // frame not finished
+  }
+  sum = 0;
+  for(i=2; i<RawN; i++)
+  {
+    sum = sum+Raw[i];                   // frame data and checksum
+  }
+  if(sum != 0xFF)
+  {
+    Stats.BadChecksum++;
+    resync();
+    return;
+  }
+  InFrame = 0;
+  dispatch();
+}
+
+void XBeeApi_Byte(unsigned char data)
+{
+  step(data);
+  while(ReplayI < ReplayN)
+  {
+    ReplayI++;
+    step(Replay[ReplayI-1]);            // may refill Replay
+  }
+}
+
+unsigned short XBeeApi_Poll(void)
+{
+  unsigned char buf[POLLCHUNK];
+  unsigned short n, i;
+  unsigned long frames;
+  frames = Stats.Frames;
+  while((n = UART1_TryRead(buf, POLLCHUNK)) != 0)
+  {
+    for(i=0; i<n; i++)
+    {
+      XBeeApi_Byte(buf[i]);
+    }
+  }
+  return (unsigned short)(Stats.Frames-frames);
+}
+
+unsigned short XBeeApi_Wait(unsigned long ms)
+{
+  unsigned char data;
+  unsigned long frames;
+  frames = Stats.Frames;
+  if(UART1_ReadTimeout(&data, 1, ms) == 1)
+  {
+    XBeeApi_Byte(data);
+  }
+  XBeeApi_Poll();
+  return (unsigned short)(Stats.Frames-frames);
+}
+
+void XBeeApi_Stats(XBeeApiStats *stats)
+{
+  *stats = Stats;
+}
+
+// one byte of the frame
+void static framePut(unsigned char data)
+{
+  if(TxUsed == TxRoom)
+  {                                     // span full, publish it, get more
+    UART1_TxCommit(TxUsed);
+    TxUsed = 0;
+    TxRoom = TxLeft;
+    TxSpan = UART1_TxReserveWait(&TxRoom); // sleeps while the ring is full
+  }
+  TxSpan[TxUsed] = data;
+  TxUsed++;
+  TxLeft--;
+  TxSum = TxSum+data;
+}
+
+// start a frame of length frame data bytes: delimiter and length
+void static frameOpen(unsigned short length)
+{
+  UART1_TxBeginFrameWait(length+4);     // sleeps for a free frame mark
+  TxRoom = TxUsed = 0;
+  TxLeft = length+4;
+  TxSum = 0;
+  framePut(XBEE_DELIMITER);
+  framePut(length>>8);
+  framePut(length&0xFF);
+  TxSum = 0;                            // the checksum covers frame data only
+}
+
+// checksum, and send what is left
+void static frameClose(void)
+{
+  framePut(0xFF-TxSum);
+  UART1_TxCommit(TxUsed);
+  TxRoom = TxUsed = 0;
+}
+
+// the payload and checksum of a TX request
+void static framePayload(const void *data, unsigned short length)
+{
+  const unsigned char *pt = data;
+  while(length)
+  {
+    framePut(*pt);
+    pt++;
+    length--;
+  }
+  frameClose();
+}
+
+int XBeeApi_Tx16(unsigned char id, unsigned short address, unsigned char options,
+                 const void *data, unsigned short length)
+{
+  if(length > XBEE_PAYLOADMAX)
+  {
+    return 0;
+  }
+  frameOpen(length+5);                  // API identifier, ID, address, options
+  framePut(XBEE_API_TX16);
+  framePut(id);
+  framePut(address>>8);
+  framePut(address&0xFF);
+  framePut(options);
+  framePayload(data, length);
+  return 1;
+}
+
+int XBeeApi_Tx64(unsigned char id, const unsigned char *address, unsigned char options,
+                 const void *data, unsigned short length)
+{
+  int i;
+  if(length > XBEE_PAYLOADMAX)
+  {
+    return 0;
+  }
+  frameOpen(length+11);                 // API identifier, ID, address, options
+  framePut(XBEE_API_TX64);
+  framePut(id);
+  for(i=0; i<8; i++)
+  {
+    framePut(address[i]);
+  }
+  framePut(options);
+  framePayload(data, length);
+  return 1;
+}
+
+int XBeeApi_At(unsigned char id, const char *command,
+               const void *parameter, unsigned short length)
+{
+  unsigned char frame[XBEEAPI_ATMAX+8];
+  const unsigned char *pt = parameter;
+  unsigned short i;
+  unsigned char sum;
+  if(length > XBEEAPI_ATMAX)
+  {
+    return 0;
+  }
+  frame[0] = XBEE_DELIMITER;
+  frame[1] = 0;
+  frame[2] = length+4;                  // API identifier, ID, command
+  frame[3] = XBEE_API_AT;
+  frame[4] = id;
+  frame[5] = command[0];
+  frame[6] = command[1];
+  sum = XBEE_API_AT+id+command[0]+command[1];
+  for(i=0; i<length; i++)
+  {
+    frame[7+i] = pt[i];
+    sum = sum+pt[i];
+  }
+  frame[7+length] = 0xFF-sum;
+  return UART1_TxHiFrameWait((char *)frame, length+8);
+}
@@ -3,13 +3,14 @@ char reponse[3];
 
 
 int XBee_CheckOK() {
-	char check[2];
+	char check[3];
 
-	//not sure if checking for <CR>, CR, or \r
-	while(response[0] != 'O' && response[1] != 'K' && response[2] != '\r') {
-		UART1_InString(response);
-		//what to do if failure?
+	//the reply ends with <CR>, which InStringTimeout does not store
+	//give up after 500 ms instead of waiting forever for a missing radio
+	if(UART1_InStringTimeout(check, sizeof(check), 500) == UART_TIMEOUT) {
+		return 0;
 	}
+	return (check[0] == 'O') && (check[1] == 'K');
 }
 
 //intialize XBee
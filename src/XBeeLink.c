@@ -0,0 +1,366 @@
+// XBeeLink.c
+// Runs on LM3S1968
+// Windowed transmission of XBee TX 16-bit requests, see XBeeLink.h
+// A resend takes a new frame ID, so a late status for an earlier send
+// of the same frame is not taken for the resend's.  Frame IDs go round
+// 1 to 255 skipping the ones in flight; ID 0 would turn off the status.
+// Everything runs in the foreground: TX statuses arrive through
+// XBeeApi_Poll, which is called from XBeeLink_Poll and XBeeLink_Send.
+// XBeeLink_Flush copies the pending payload out and empties it before
+// XBeeLink_Send can wait, so the XBeeLink_Poll calls meanwhile cannot
+// send it twice, and a receive handler that queues a new message then
+// cannot overwrite the bytes still to be sent.
+// XBeeLink_Queue never waits: a receive handler runs inside the XBeeApi
+// parser, and waiting there would run the parser again over the frame
+// being handled.  A payload the window has no room for stays pending
+// for XBeeLink_Poll.
+
+#include "XBeeLink.h"
+#include "XBeeApi.h"
+#include "SysTick.h"
+
+typedef struct{
+  unsigned char Id;                     // frame ID of the last send, 0 if the slot is free
+  unsigned char Tries;                  // sends so far
+  unsigned short Address;
+  unsigned short Length;
+  unsigned long SentAt;                 // SysTick_Ms of the last send
+  unsigned char Data[XBEE_PAYLOADMAX];
+} Slot;
+
+Slot static Window[XBEELINK_WINDOW];
+unsigned short static InFlight;         // slots in use
+unsigned char static NextId = 1;
+unsigned long static Start;             // SysTick_Ms when counting began
+unsigned long static RttSum;            // for the average
+unsigned long static Wake;              // ms until the next status is overdue
+XBeeLinkStats static Stats;
+unsigned char static Pending[XBEE_PAYLOADMAX]; // queued messages
+unsigned short static PendingN;         // bytes in Pending
+unsigned short static PendingTo;        // their address
+unsigned long static PendingAt;         // SysTick_Ms of the first one
+XBeeMessageHandler static Receiver;     // for XBeeLink_Receive
+
+void static txStatus(const unsigned char *frame, unsigned short length);
+
+// a frame ID that is not in flight, never 0
+unsigned char static newId(void)
+{
+  int i;
+  unsigned char id;
+  do
+  {
+    id = NextId;
+    NextId++;
+    if(NextId == 0)
+    {
+      NextId = 1;
+    }
+    for(i=0; i<XBEELINK_WINDOW; i++)
+    {
+      if(Window[i].Id == id)
+      {
+        break;
+      }
+    }
+  }
+  while(i < XBEELINK_WINDOW);           // at most XBEELINK_WINDOW+1 tries
+  return id;
+}
+
+// (re)send the frame in one slot
+void static send(Slot *s)
+{
+  s->Id = newId();
+  s->Tries++;
+  XBeeApi_Tx16(s->Id, s->Address, 0, s->Data, s->Length);
+  s->SentAt = SysTick_Ms();             // after Tx16, which may wait for TX room
+}
+
+// a send of this slot failed or timed out, try again or give up
+void static retry(Slot *s)
+{
+  if(s->Tries < XBEELINK_TRIES)
+  {
+    Stats.Retries++;
+    send(s);
+  }
+  else
+  {
+    Stats.Failed++;
+    s->Id = 0;
+    InFlight--;
+  }
+}
+
+// XBEE_API_TXSTATUS handler: API identifier, frame ID, status
+void static txStatus(const unsigned char *frame, unsigned short length)
+{
+  int i;
+  unsigned long rtt;
+  Slot *s;
+  if((length < 3) || (frame[1] == 0))
+  {
+    return;
+  }
+  for(i=0; i<XBEELINK_WINDOW; i++)
+  {
+    s = &Window[i];
+    if(s->Id == frame[1])
+    {
+      if(frame[2] != 0)
+      {                                 // no ACK, CCA failure or purged
+        retry(s);
+        return;
+      }
+      rtt = SysTick_Ms()-s->SentAt;
+      if(rtt < Stats.RttMin)
+      {
+        Stats.RttMin = rtt;
+      }
+      if(rtt > Stats.RttMax)
+      {
+        Stats.RttMax = rtt;
+      }
+      RttSum = RttSum+rtt;
+      Stats.Delivered++;
+      Stats.Bytes = Stats.Bytes+s->Length;
+      s->Id = 0;
+      InFlight--;
+      return;
+    }
+  }                                     // not ours, or already resent
+}
+
+void XBeeLink_ResetStats(void)
+{
+  XBeeLinkStats empty = {0};
+  Stats = empty;
+  Stats.RttMin = 0xFFFFFFFF;
+  RttSum = 0;
+  Start = SysTick_Ms();
+}
+
+void XBeeLink_Init(void)
+{
+  int i;
+  for(i=0; i<XBEELINK_WINDOW; i++)
+  {
+    Window[i].Id = 0;
+  }
+  InFlight = 0;
+  PendingN = 0;
+  XBeeLink_ResetStats();
+  XBeeApi_Register(XBEE_API_TXSTATUS, txStatus);
+}
+
+int XBeeLink_TrySend(unsigned short address, const void *data, unsigned short length)
+{
+  int i, j;
+  const unsigned char *pt = data;
+  Slot *s;
+  if(length > XBEE_PAYLOADMAX)
+  {
+    return 0;
+  }
+  for(i=0; i<XBEELINK_WINDOW; i++)
+  {
+    s = &Window[i];
+    if(s->Id == 0)
+    {
+      s->Address = address;
+      s->Length = length;
+      for(j=0; j<length; j++)
+      {
+        s->Data[j] = pt[j];
+      }
+      s->Tries = 0;
+      InFlight++;
+      Stats.Sent++;
+      send(s);
+      return 1;
+    }
+  }
+  return 0;                             // window full
+}
+
+int XBeeLink_Send(unsigned short address, const void *data, unsigned short length)
+{
+  if(length > XBEE_PAYLOADMAX)
+  {
+    return 0;
+  }
+  while(!XBeeLink_TrySend(address, data, length))
+  {
+    XBeeApi_Wait(Wake);                 // sleep until a status comes or is overdue
+    XBeeLink_Poll();
+  }
+  return 1;
+}
+
+// send the pending payload if the window has room, without waiting
+// Output: 1 if nothing is pending any more
+int static trySendPending(void)
+{
+  if(PendingN && XBeeLink_TrySend(PendingTo, Pending, PendingN))
+  {                                     // the slot has its own copy
+    PendingN = 0;
+  }
+  return PendingN == 0;
+}
+
+void XBeeLink_Flush(void)
+{
+  unsigned char payload[XBEE_PAYLOADMAX];
+  unsigned short n, i;
+  n = PendingN;
+  if(n)
+  {
+    for(i=0; i<n; i++)
+    {                                   // before XBeeLink_Send can wait
+      payload[i] = Pending[i];
+    }
+    PendingN = 0;
+    XBeeLink_Send(PendingTo, payload, n);
+  }
+}
+
+int XBeeLink_Queue(unsigned short address, const void *message, unsigned char length)
+{
+  int i;
+  const unsigned char *pt = message;
+  if(length > XBEELINK_MSGMAX)
+  {
+    return 0;
+  }
+  if(PendingN && ((address != PendingTo) || (PendingN+1+length > XBEE_PAYLOADMAX)))
+  {
+    if(!trySendPending())
+    {
+      return 0;                         // window full, pending until XBeeLink_Poll
+    }
+  }
+  if(PendingN == 0)
+  {
+    PendingTo = address;
+    PendingAt = SysTick_Ms();
+  }
+  Pending[PendingN] = length;
+  PendingN++;
+  for(i=0; i<length; i++)
+  {
+    Pending[PendingN] = pt[i];
+    PendingN++;
+  }
+  Stats.Messages++;
+  if(PendingN >= XBEE_PAYLOADMAX-1)
+  {                                     // no room for another message
+    trySendPending();
+  }
+  return 1;
+}
+
+int XBeeLink_Unpack(const unsigned char *payload, unsigned short length,
+                    XBeeMessageHandler handler)
+{
+  unsigned short i;
+  int messages;
+  i = 0;
+  messages = 0;
+  while(i < length)
+  {
+    if(payload[i] > length-i-1)
+    {
+      return -1;                        // length byte runs past the end
+    }
+    handler(&payload[i+1], payload[i]);
+    messages++;
+    i = i+1+payload[i];
+  }
+  return messages;
+}
+
+// XBEE_API_RX16 and XBEE_API_RX64 handler: API identifier, source
+// address (2 or 8 bytes), RSSI, options, payload
+void static rxFrame(const unsigned char *frame, unsigned short length)
+{
+  unsigned short header;
+  header = (frame[0] == XBEE_API_RX16) ? 5 : 11;
+  if(Receiver && (length >= header))
+  {
+    XBeeLink_Unpack(&frame[header], length-header, Receiver);
+  }
+}
+
+void XBeeLink_Receive(XBeeMessageHandler handler)
+{
+  Receiver = handler;
+  XBeeApi_Register(XBEE_API_RX16, handler ? rxFrame : 0);
+  XBeeApi_Register(XBEE_API_RX64, handler ? rxFrame : 0);
+}
+
+unsigned short XBeeLink_Poll(void)
+{
+  int i;
+  unsigned long now, age;
+  Slot *s;
+  XBeeApi_Poll();
+  now = SysTick_Ms();
+  Wake = XBEELINK_TIMEOUT;
+  for(i=0; i<XBEELINK_WINDOW; i++)
+  {
+    s = &Window[i];
+    if(s->Id)
+    {
+      age = now-s->SentAt;
+      if(age >= XBEELINK_TIMEOUT)
+      {
+        Stats.Timeouts++;
+        retry(s);                       // sent again now, or given up
+      }
+      else if(XBEELINK_TIMEOUT-age < Wake)
+      {
+        Wake = XBEELINK_TIMEOUT-age;
+      }
+    }
+  }
+  if(PendingN)
+  {
+    age = now-PendingAt;
+    if((age < XBEELINK_COALESCE) && (PendingN < XBEE_PAYLOADMAX-1))
+    {
+      if(XBEELINK_COALESCE-age < Wake)
+      {
+        Wake = XBEELINK_COALESCE-age;
+      }
+    }
+    else
+    {                                   // without waiting, tried again next time if full
+      trySendPending();
+    }
+  }
+  return InFlight;
+}
+
+void XBeeLink_Stats(XBeeLinkStats *stats)
+{
+  unsigned long ms;
+  *stats = Stats;
+  ms = SysTick_Ms()-Start;
+  if(ms >= 1000000)
+  {                                     // Bytes*1000 could overflow
+    stats->Goodput = Stats.Bytes/(ms/1000);
+  }
+  else if(ms)
+  {
+    stats->Goodput = (Stats.Bytes/ms)*1000+((Stats.Bytes%ms)*1000)/ms;
+  }
+  if(Stats.Delivered)
+  {
+    stats->RttAvg = RttSum/Stats.Delivered;
+  }
+  else
+  {
+    stats->RttMin = 0;
+  }
+}